@@ -0,0 +1,49 @@
+#ifndef MortonOrder_h
+#define MortonOrder_h
+
+#include <algorithm>
+#include <stdint.h>
+
+// Z-order (Morton order) of 2D points, for the bench's spawn-order comparison and
+// broadphase reinsertion. Only needs points with float x and y members, so it works
+// on both G3D's Vector2 and Box2D's b2Vec2 and doesn't pull in either library.
+
+// Spreads the low 16 bits of v out to the even bits of the result
+inline uint32_t spreadBits(uint32_t v) {
+	v &= 0xffff;
+	v = (v | (v << 8)) & 0x00ff00ff;
+	v = (v | (v << 4)) & 0x0f0f0f0f;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+// Fills order[0..count-1] with (Morton code << 32) | index for every point, sorted,
+// so that reading the low 32 bits in order visits the points along a Z-order curve
+template<class Point>
+void mortonOrder(const Point *points, int count, uint64_t *order) {
+	if (count == 0) {
+		return;
+	}
+
+	float lowerX = points[0].x, lowerY = points[0].y;
+	float upperX = lowerX, upperY = lowerY;
+	for (int i = 1; i < count; i++) {
+		lowerX = std::min(lowerX, (float)points[i].x);
+		lowerY = std::min(lowerY, (float)points[i].y);
+		upperX = std::max(upperX, (float)points[i].x);
+		upperY = std::max(upperY, (float)points[i].y);
+	}
+	const float extentX = std::max(upperX - lowerX, 1e-6f);
+	const float extentY = std::max(upperY - lowerY, 1e-6f);
+
+	for (int i = 0; i < count; i++) {
+		// Quantize to a 65536 x 65536 grid over the bounds
+		const uint32_t x = (uint32_t)((points[i].x - lowerX) / extentX * 65535.0f);
+		const uint32_t y = (uint32_t)((points[i].y - lowerY) / extentY * 65535.0f);
+		order[i] = ((uint64_t)(spreadBits(x) | (spreadBits(y) << 1)) << 32) | (uint32_t)i;
+	}
+	std::sort(order, order + count);
+}
+
+#endif
@@ -0,0 +1,415 @@
+// Headless benchmark for the Box2D side of CrayonPhysics. It builds scenes like
+// the ones people sketch in the app, steps them for a fixed number of frames
+// and prints one JSON object per scene with wall-clock step times and the
+// per-phase averages from b2Profile. It then times a fixed grid of AABB queries,
+// reinserts the dynamic bodies into the broadphase tree in Morton order, and
+// times the same queries again.
+//
+// Links only Box2D, e.g. on the Mac:
+//   clang++ -O2 -std=c++11 -I../Box2D/v2.3.1/include main.cpp ../Box2D/v2.3.1/mac-prebuilt-lib/libBox2D.a -o bench
+//
+// The spawn scene instead times creating App's 2400-body preset in the order it is
+// listed and in Morton order, best of --repeats fresh worlds each.
+//
+// Usage: bench [--frames N] [--repeats N] [--scene pile|stacks|sleepers|spawn]
+
+#include <Box2D/Box2D.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "MortonOrder.h"
+
+// Same stepping parameters as Simulation in CrayonPhysicsStudent
+static const float TIME_STEP = 1/120.0f;
+static const int VELOCITY_ITERATIONS = 6;
+static const int POSITION_ITERATIONS = 2;
+
+// Same fixtures as Simulation::addCircle, addBox and addPolyline
+static void addCircle(b2World *world, float x, float y, float radius) {
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position.Set(x, y);
+	b2Body *body = world->CreateBody(&bodyDef);
+
+	b2CircleShape circle;
+	circle.m_radius = radius;
+	b2FixtureDef fixtureDef;
+	fixtureDef.shape = &circle;
+	fixtureDef.density = .2f;
+	fixtureDef.friction = .3f;
+	fixtureDef.restitution = 0.3f;
+	body->CreateFixture(&fixtureDef);
+}
+
+static void addBox(b2World *world, float x, float y, float width, float height) {
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position.Set(x, y);
+	b2Body *body = world->CreateBody(&bodyDef);
+
+	b2PolygonShape boxShape;
+	boxShape.SetAsBox(width/2, height/2);
+	b2FixtureDef fixtureDef;
+	fixtureDef.shape = &boxShape;
+	fixtureDef.density = .2f;
+	fixtureDef.friction = .3f;
+	fixtureDef.restitution = 0.3f;
+	body->CreateFixture(&fixtureDef);
+}
+
+static void addPolyline(b2World *world, const std::vector<b2Vec2> &verts) {
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_staticBody;
+	b2Body *body = world->CreateBody(&bodyDef);
+
+	b2ChainShape chainShape;
+	chainShape.CreateChain(&verts[0], (int32)verts.size());
+	b2FixtureDef fixtureDef;
+	fixtureDef.shape = &chainShape;
+	fixtureDef.density = .2f;
+	fixtureDef.friction = .3f;
+	fixtureDef.restitution = 1.0f;
+	body->CreateFixture(&fixtureDef);
+}
+
+// A hand-drawn looking ground: points every 0.1 units, like the app keeps from a sketch
+static void addWavyGround(b2World *world, float x0, float x1, float y) {
+	std::vector<b2Vec2> verts;
+	for (float x = x0; x <= x1; x += 0.1f) {
+		verts.push_back(b2Vec2(x, y + 0.3f * sinf(x * 1.7f) + 0.05f * sinf(x * 13.0f)));
+	}
+	addPolyline(world, verts);
+}
+
+// Circles and boxes dropped onto a few long sketched strokes
+static void buildPile(b2World *world) {
+	addWavyGround(world, -40, 40, -5);
+	addWavyGround(world, -20, 0, 5);
+	addWavyGround(world, 5, 25, 8);
+	for (int i = 0; i < 600; i++) {
+		float x = -30 + (i % 60) * 1.0f;
+		float y = 15 + (i / 60) * 1.2f;
+		if (i % 2) {
+			addCircle(world, x, y, 0.2f + 0.1f * (i % 3));
+		} else {
+			addBox(world, x, y, 0.4f + 0.1f * (i % 4), 0.3f + 0.1f * (i % 3));
+		}
+	}
+}
+
+// Tall towers of boxes that topple into each other
+static void buildStacks(b2World *world) {
+	addWavyGround(world, -40, 40, 0);
+	for (int tower = 0; tower < 20; tower++) {
+		float x = -30 + tower * 3.0f;
+		for (int level = 0; level < 25; level++) {
+			// Lean every tower a little so they all fall over
+			addBox(world, x + level * 0.04f, 0.8f + level * 0.5f, 0.5f, 0.5f);
+		}
+	}
+}
+
+// Thousands of bodies resting on flat ground, mostly asleep after the first second
+static void buildSleepers(b2World *world) {
+	std::vector<b2Vec2> ground;
+	ground.push_back(b2Vec2(-200, 0));
+	ground.push_back(b2Vec2(200, 0));
+	addPolyline(world, ground);
+	for (int i = 0; i < 4000; i++) {
+		float x = -190 + (i % 400) * 0.95f;
+		float y = 0.3f + (i / 400) * 0.61f;
+		addBox(world, x, y, 0.6f, 0.6f);
+	}
+}
+
+struct Scene {
+	const char *name;
+	void (*build)(b2World *world);
+};
+
+static const Scene SCENES[] = {
+	{ "pile", buildPile },
+	{ "stacks", buildStacks },
+	{ "sleepers", buildSleepers }
+};
+
+// Counts the fixtures a query touches, so both query runs can be checked to agree
+class CountingQuery : public b2QueryCallback {
+public:
+	int hits;
+	CountingQuery() : hits(0) {}
+	bool ReportFixture(b2Fixture *) {
+		hits++;
+		return true;
+	}
+};
+
+// Queries a QUERY_GRID x QUERY_GRID grid of AABBs the size of a few bodies over the
+// dynamic bodies' bounds, QUERY_REPEATS times, and returns the fastest run in microseconds
+static const int QUERY_GRID = 64;
+static const int QUERY_REPEATS = 5;
+
+static double timeQueries(b2World *world, const b2AABB &bounds, int *hits) {
+	typedef std::chrono::high_resolution_clock Clock;
+	const b2Vec2 size = bounds.upperBound - bounds.lowerBound;
+	double best = 0;
+	for (int repeat = 0; repeat < QUERY_REPEATS; repeat++) {
+		CountingQuery query;
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < QUERY_GRID * QUERY_GRID; i++) {
+			b2AABB aabb;
+			aabb.lowerBound.Set(bounds.lowerBound.x + size.x * (i % QUERY_GRID) / QUERY_GRID,
+				bounds.lowerBound.y + size.y * (i / QUERY_GRID) / QUERY_GRID);
+			aabb.upperBound = aabb.lowerBound + b2Vec2(1.5f, 1.5f);
+			world->QueryAABB(&query, aabb);
+		}
+		double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+		best = (repeat == 0) ? us : std::min(best, us);
+		*hits = query.hits;
+	}
+	return best;
+}
+
+// Deactivates every dynamic body and reactivates them in Morton order of their
+// positions. This is the only rebuild of the broadphase tree that Box2D's public
+// API allows, and it throws away every dynamic contact.
+static void rebuildBroadphase(b2World *world) {
+	std::vector<b2Body*> bodies;
+	std::vector<b2Vec2> positions;
+	for (b2Body *b = world->GetBodyList(); b; b = b->GetNext()) {
+		if (b->GetType() == b2_dynamicBody) {
+			bodies.push_back(b);
+			positions.push_back(b->GetPosition());
+		}
+	}
+	if (bodies.empty()) {
+		return;
+	}
+
+	std::vector<uint64_t> order(bodies.size());
+	mortonOrder(&positions[0], (int)positions.size(), &order[0]);
+
+	for (size_t i = 0; i < bodies.size(); i++) {
+		bodies[i]->SetActive(false);
+	}
+	for (size_t i = 0; i < order.size(); i++) {
+		bodies[(size_t)(order[i] & 0xffffffff)]->SetActive(true);
+	}
+}
+
+// The 2400 bodies App::spawnPreset drops with P, in the order it lists them
+struct Spawn {
+	b2Vec2 position;
+	bool circle;
+};
+
+static std::vector<Spawn> presetSpawns() {
+	const int columns = 60;
+	const int rows = 40;
+	std::vector<Spawn> spawns(columns * rows);
+	for (int i = 0; i < columns * rows; i++) {
+		spawns[i].position.Set(-15 + (i % columns) * 0.5f, 5 + (i / columns) * 0.5f);
+		spawns[i].circle = (i % 2) != 0;
+	}
+	return spawns;
+}
+
+struct SpawnTiming {
+	double createMs;
+	double firstStepMs;
+	float treeQuality;
+};
+
+// Creates spawns in a fresh world in the given order, like Simulation::addBodies,
+// and times that and the first step, which finds the new bodies' contacts
+static SpawnTiming timeSpawn(const std::vector<Spawn> &spawns, const std::vector<int> &order) {
+	typedef std::chrono::high_resolution_clock Clock;
+	b2World world(b2Vec2(0, -9.8f));
+	addWavyGround(&world, -20, 20, 0);
+
+	SpawnTiming timing;
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < order.size(); i++) {
+		const Spawn &spawn = spawns[order[i]];
+		if (spawn.circle) {
+			addCircle(&world, spawn.position.x, spawn.position.y, 0.15f);
+		} else {
+			addBox(&world, spawn.position.x, spawn.position.y, 0.3f, 0.3f);
+		}
+	}
+	timing.createMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	world.Step(TIME_STEP, VELOCITY_ITERATIONS, POSITION_ITERATIONS);
+	timing.firstStepMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	timing.treeQuality = world.GetTreeQuality();
+	return timing;
+}
+
+// Best of repeats for each field, since a single creation pass is short enough to be noisy
+static SpawnTiming bestSpawn(const std::vector<Spawn> &spawns, const std::vector<int> &order, int repeats) {
+	SpawnTiming best = timeSpawn(spawns, order);
+	for (int i = 1; i < repeats; i++) {
+		SpawnTiming timing = timeSpawn(spawns, order);
+		best.createMs = std::min(best.createMs, timing.createMs);
+		best.firstStepMs = std::min(best.firstStepMs, timing.firstStepMs);
+	}
+	return best;
+}
+
+// Compares creating the preset in the order it is listed with creating it in
+// Morton order of the positions, to see whether sorting a batch speeds up loading
+static void runSpawn(int repeats) {
+	const std::vector<Spawn> spawns = presetSpawns();
+
+	std::vector<int> listed(spawns.size());
+	std::vector<b2Vec2> positions(spawns.size());
+	for (size_t i = 0; i < spawns.size(); i++) {
+		listed[i] = (int)i;
+		positions[i] = spawns[i].position;
+	}
+
+	std::vector<uint64_t> codes(spawns.size());
+	mortonOrder(&positions[0], (int)positions.size(), &codes[0]);
+	std::vector<int> morton(spawns.size());
+	for (size_t i = 0; i < codes.size(); i++) {
+		morton[i] = (int)(codes[i] & 0xffffffff);
+	}
+
+	const SpawnTiming a = bestSpawn(spawns, listed, repeats);
+	const SpawnTiming b = bestSpawn(spawns, morton, repeats);
+	printf("{\"scene\":\"spawn\",\"bodies\":%d,\"repeats\":%d,"
+		"\"listedOrder\":{\"createMs\":%.3f,\"firstStepMs\":%.3f,\"treeQuality\":%.3f},"
+		"\"mortonOrder\":{\"createMs\":%.3f,\"firstStepMs\":%.3f,\"treeQuality\":%.3f}}\n",
+		(int)spawns.size(), repeats,
+		a.createMs, a.firstStepMs, a.treeQuality,
+		b.createMs, b.firstStepMs, b.treeQuality);
+	fflush(stdout);
+}
+
+static double percentile(const std::vector<double> &sorted, double p) {
+	size_t i = (size_t)std::ceil(p * sorted.size());
+	return sorted[std::min(i == 0 ? 0 : i - 1, sorted.size() - 1)];
+}
+
+static void run(const Scene &scene, int frames) {
+	b2World world(b2Vec2(0, -9.8f));
+
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point buildStart = Clock::now();
+	scene.build(&world);
+	double buildMs = std::chrono::duration<double, std::milli>(Clock::now() - buildStart).count();
+
+	std::vector<double> stepMs;
+	stepMs.reserve(frames);
+	b2Profile total;
+	memset(&total, 0, sizeof(total));
+
+	for (int frame = 0; frame < frames; frame++) {
+		Clock::time_point start = Clock::now();
+		world.Step(TIME_STEP, VELOCITY_ITERATIONS, POSITION_ITERATIONS);
+		stepMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+		// b2Profile is reported in milliseconds for the last step only
+		const b2Profile &profile = world.GetProfile();
+		total.step += profile.step;
+		total.collide += profile.collide;
+		total.solve += profile.solve;
+		total.solveInit += profile.solveInit;
+		total.solveVelocity += profile.solveVelocity;
+		total.solvePosition += profile.solvePosition;
+		total.broadphase += profile.broadphase;
+		total.solveTOI += profile.solveTOI;
+	}
+
+	double sum = 0;
+	for (size_t i = 0; i < stepMs.size(); i++) {
+		sum += stepMs[i];
+	}
+	std::vector<double> sorted(stepMs);
+	std::sort(sorted.begin(), sorted.end());
+
+	int awake = 0;
+	b2AABB bounds;
+	bounds.lowerBound.Set(b2_maxFloat, b2_maxFloat);
+	bounds.upperBound.Set(-b2_maxFloat, -b2_maxFloat);
+	for (const b2Body *b = world.GetBodyList(); b; b = b->GetNext()) {
+		if (b->GetType() == b2_dynamicBody) {
+			awake += b->IsAwake() ? 1 : 0;
+			bounds.lowerBound = b2Min(bounds.lowerBound, b->GetPosition());
+			bounds.upperBound = b2Max(bounds.upperBound, b->GetPosition());
+		}
+	}
+	const int contacts = world.GetContactCount();
+	const float treeQuality = world.GetTreeQuality();
+	const int treeHeight = world.GetTreeHeight();
+	const int treeBalance = world.GetTreeBalance();
+
+	int hitsBefore = 0, hitsAfter = 0;
+	const double queryUsBefore = timeQueries(&world, bounds, &hitsBefore);
+	Clock::time_point rebuildStart = Clock::now();
+	rebuildBroadphase(&world);
+	const double rebuildMs = std::chrono::duration<double, std::milli>(Clock::now() - rebuildStart).count();
+	const double queryUsAfter = timeQueries(&world, bounds, &hitsAfter);
+	const float treeQualityAfter = world.GetTreeQuality();
+	const int treeHeightAfter = world.GetTreeHeight();
+	const int treeBalanceAfter = world.GetTreeBalance();
+
+	// The first step after a rebuild recreates every dynamic contact from scratch
+	Clock::time_point stepStart = Clock::now();
+	world.Step(TIME_STEP, VELOCITY_ITERATIONS, POSITION_ITERATIONS);
+	const double firstStepMs = std::chrono::duration<double, std::milli>(Clock::now() - stepStart).count();
+
+	printf("{\"scene\":\"%s\",\"frames\":%d,\"bodies\":%d,\"awakeAtEnd\":%d,\"proxies\":%d,\"contacts\":%d,"
+		"\"treeQuality\":%.3f,\"treeHeight\":%d,\"treeBalance\":%d,"
+		"\"buildMs\":%.3f,\"stepsPerSecond\":%.1f,"
+		"\"stepMs\":{\"mean\":%.4f,\"p50\":%.4f,\"p90\":%.4f,\"p99\":%.4f,\"max\":%.4f},"
+		"\"profileMs\":{\"step\":%.4f,\"collide\":%.4f,\"solve\":%.4f,\"solveInit\":%.4f,"
+		"\"solveVelocity\":%.4f,\"solvePosition\":%.4f,\"broadphase\":%.4f,\"solveTOI\":%.4f},"
+		"\"rebuild\":{\"ms\":%.3f,\"queries\":%d,\"queryUsBefore\":%.1f,\"queryUsAfter\":%.1f,"
+		"\"hitsBefore\":%d,\"hitsAfter\":%d,\"treeQualityAfter\":%.3f,\"treeHeightAfter\":%d,"
+		"\"treeBalanceAfter\":%d,\"firstStepMs\":%.4f,\"contactsAfterStep\":%d}}\n",
+		scene.name, frames, world.GetBodyCount(), awake, world.GetProxyCount(), contacts,
+		treeQuality, treeHeight, treeBalance,
+		buildMs, 1000.0 * frames / sum,
+		sum / frames, percentile(sorted, 0.5), percentile(sorted, 0.9), percentile(sorted, 0.99), sorted.back(),
+		total.step / frames, total.collide / frames, total.solve / frames, total.solveInit / frames,
+		total.solveVelocity / frames, total.solvePosition / frames, total.broadphase / frames, total.solveTOI / frames,
+		rebuildMs, QUERY_GRID * QUERY_GRID, queryUsBefore, queryUsAfter,
+		hitsBefore, hitsAfter, treeQualityAfter, treeHeightAfter,
+		treeBalanceAfter, firstStepMs, world.GetContactCount());
+	fflush(stdout);
+}
+
+int main(int argc, const char* argv[]) {
+	int frames = 1200;
+	int repeats = 5;
+	const char *only = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frames = std::max(1, atoi(argv[++i]));
+		} else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+			repeats = std::max(1, atoi(argv[++i]));
+		} else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+			only = argv[++i];
+		} else {
+			fprintf(stderr, "usage: %s [--frames N] [--repeats N] [--scene pile|stacks|sleepers|spawn]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	for (size_t i = 0; i < sizeof(SCENES) / sizeof(SCENES[0]); i++) {
+		if (only == NULL || strcmp(only, SCENES[i].name) == 0) {
+			run(SCENES[i], frames);
+		}
+	}
+	if (only == NULL || strcmp(only, "spawn") == 0) {
+		runSpawn(repeats);
+	}
+	return 0;
+}
@@ -2,6 +2,27 @@
 #include "config.h"
 #include <Box2D/Box2D.h>
 
+static const Color3 CIRCLE_COLOR(0.20,0.79,0.20);
+static const Color3 BOX_COLOR(0.44,0.52,0.93);
+static const Color3 BACKGROUND_COLOR(0.9,0.5,0.2);
+
+// Sketched background shapes may deviate from the stroke by this many pixels when simplified
+static const float SIMPLIFY_TOLERANCE_PIXELS = 1.5f;
+
+// Blends a body's transform from the previous physics step towards the current one
+static void interpolateTransform(const BodySnapshot &body, float alpha, Vector2 &position, float &angle) {
+	position = body.previousPosition + (body.position - body.previousPosition) * alpha;
+	angle = lerp(body.previousAngle, body.angle, alpha);
+}
+
+// First index of App::circleInstances and App::boxInstances
+enum { ASLEEP = 0, AWAKE = 1 };
+
+// Object-to-world matrix of a body: a rotation about z by angle, then its position
+static CoordinateFrame bodyFrame(const Vector2 &position, float angle) {
+	return CoordinateFrame(Matrix3::fromAxisAngle(Vector3::unitZ(), angle), Vector3(position, 0));
+}
+
 App::App(const GApp::Settings& settings) : GApp(settings) {
 	renderDevice->setColorClearValue(Color3(0.2, 0.2, 0.2));
 	renderDevice->setSwapBuffersAutomatically(true);
@@ -16,8 +37,11 @@ void App::onInit() {
 	developerWindow->cameraControlWindow->setVisible(false);
 	showRenderingStats = false;
 
-    //create Box2D world, setting gravity vector
-	world = new b2World(b2Vec2(0, -9.8));
+	// Physics runs on this thread until threaded simulation is switched on with T
+	simulation.reset(new Simulation());
+	viewCulling = true;
+	killVolume = false;
+	viewRegionValid = false;
     
 
 	// This load shaders from disk, we do it once when the program starts up, but
@@ -26,6 +50,14 @@ void App::onInit() {
 	// while your program is running!
 	reloadShaders();
 
+	// Build the sphere and box meshes once; every body reuses them with its own transform
+	meshCache.reset(new MeshCache());
+	instancedRendering = true;
+	drawnSleepingGeneration = 0;
+	sleepingLodPixelsPerUnit = 0;
+	showMemoryStats = false;
+	physicsDebugMode = 0;
+
 	// This is a simple manipulator for moving the camera around in the scene based on mouse movement
 	turntable.reset(new TurntableManipulator());
 	turntable->setEnabled(true);
@@ -62,6 +94,55 @@ bool App::onEvent(const GEvent& e) {
 		reloadShaders();
 		return true;
 	}
+	// Press T to move physics onto its own thread, or back
+	if (e.type == GEventType::KEY_DOWN && e.key.keysym.unicode == 'T') {
+		setThreadedSimulation(!simulationThread);
+		return true;
+	}
+	// Press C to clear the scene
+	if (e.type == GEventType::KEY_DOWN && e.key.keysym.unicode == 'C') {
+		resetWorld();
+		return true;
+	}
+	// Press D to cycle the physics debug overlay: off, shapes, shapes and AABBs
+	if (e.type == GEventType::KEY_DOWN && e.key.keysym.unicode == 'D') {
+		physicsDebugMode = (physicsDebugMode + 1) % 3;
+		physicsDebugDraw.SetFlags(physicsDebugMode == 2 ? (b2Draw::e_shapeBit | b2Draw::e_aabbBit) : b2Draw::e_shapeBit);
+		return true;
+	}
+	// Press P to drop a preset pile of bodies into the scene
+	if (e.type == GEventType::KEY_DOWN && e.key.keysym.unicode == 'P') {
+		spawnPreset();
+		return true;
+	}
+	// Press M to show or hide memory statistics
+	if (e.type == GEventType::KEY_DOWN && e.key.keysym.unicode == 'M') {
+		showMemoryStats = !showMemoryStats;
+		return true;
+	}
+	// Press V to switch culling of off-screen bodies on or off
+	if (e.type == GEventType::KEY_DOWN && e.key.keysym.unicode == 'V') {
+		viewCulling = !viewCulling;
+		return true;
+	}
+	// Press K to switch the kill volume for bodies that leave the scene on or off
+	if (e.type == GEventType::KEY_DOWN && e.key.keysym.unicode == 'K') {
+		killVolume = !killVolume;
+		SimulationCommand command;
+		command.type = SimulationCommand::SET_KILL_VOLUME;
+		command.width = killVolume ? 1.0f : 0.0f;
+		post(command);
+		return true;
+	}
+	// Mouse motion arrives here at the rate the OS reports it, not once per frame
+	if (e.type == GEventType::MOUSE_MOTION && strokeCapture.active()) {
+		strokeCapture.moveTo(Vector2(e.motion.x, e.motion.y), System::time());
+	}
+	// Press I to switch between instanced and per-body drawing
+	if (e.type == GEventType::KEY_DOWN && e.key.keysym.unicode == 'I') {
+		instancedRendering = !instancedRendering;
+		return true;
+	}
 	return false;
 }
 
@@ -69,13 +150,20 @@ bool App::onEvent(const GEvent& e) {
 void App::onUserInput(UserInput *userInput) {
 	GApp::onUserInput(userInput);
 
-	// If the mouse is down, then add to the sketched path
+	// If the mouse is down, then add to the sketched path. Most points come from
+	// MOUSE_MOTION events in onEvent; this also catches the press itself.
 	if (userInput->keyDown(GKey::LEFT_MOUSE)) {
-		sketchedPath.append(userInput->mouseXY());
+		if (strokeCapture.active()) {
+			strokeCapture.moveTo(userInput->mouseXY(), System::time());
+		} else {
+			strokeCapture.begin(userInput->mouseXY(), System::time());
+		}
 	}
 
 	// When you release the mouse, then interpret the mouse movement as a menu selection or a sketched path
 	if (userInput->keyReleased(GKey::LEFT_MOUSE)) {
+		strokeCapture.end(userInput->mouseXY(), System::time());
+		const Array<Vector2> &sketchedPath = strokeCapture.points();
 
 		// Case 1: Mouse is on the top portion of the screen, so do menu selection
 		// convert mouse position in pixels to a floating point number from 0.0 to 1.0
@@ -91,48 +179,20 @@ void App::onUserInput(UserInput *userInput) {
 			else {
 				sketchMode = SKETCHING_BOXES;
 			}
-			sketchedPath.clear();
+			strokeCapture.clear();
+			sketchBuffer.clear();
 		}
 
 
 		// Case 2: Mouse is on the bottom portion of the screen, so interpret movement as drawing a line.
 		else if (sketchedPath.size()) {
-			Array<Vector3> sketched3DPath;
-			Vector3 minP;
-			Vector3 maxP;
-			for (int i=0;i<sketchedPath.size();i++) {
-				Vector3 p;
-				Plane plane1(Vector3(0,0,1),Vector3(0,0,0));
-				Plane plane2(Vector3(0,0,-1),Vector3(0,0,0));
-				Ray ray = m_activeCamera->worldRay(sketchedPath[i][0], sketchedPath[i][1], renderDevice->viewport());
-				Vector3 intersectionPoint = ray.intersection(plane1);
-				if (!intersectionPoint.isFinite()) {
-					intersectionPoint = ray.intersection(plane2);
-					if (!intersectionPoint.isFinite()) {
-						intersectionPoint = Vector3(0,0,0);
-					}
-				}
-				p = intersectionPoint;
-
-				// Uncomment the following two lines if you're working with 3D physics
-				//Vector3 proj = m_activeCamera->project(Vector3(0,0,0), renderDevice->viewport());
-				//p = m_activeCamera->unproject(Vector3(sketchedPath[i][0], sketchedPath[i][1], proj.z), renderDevice->viewport());
-
-
-				sketched3DPath.append(p);
-				if (i==0) {
-					minP = p;
-					maxP = p;
-				}
-				else {
-					minP[0] = G3D::min(minP[0], p[0]);
-					minP[1] = G3D::min(minP[1], p[1]);
-					minP[2] = G3D::min(minP[2], p[2]);
-					maxP[0] = G3D::max(maxP[0], p[0]);
-					maxP[1] = G3D::max(maxP[1], p[1]);
-					maxP[2] = G3D::max(maxP[2], p[2]);
-				}
-			}
+			// Project the whole stroke onto the z=0 plane in one pass, bounds included
+			Array<Vector2> sketched2DPath;
+			Vector2 lower, upper;
+			unprojectToGround(screenToWorldMatrix(*m_activeCamera, renderDevice->viewport()), renderDevice->viewport(),
+				sketchedPath, sketched2DPath, lower, upper);
+			Vector3 minP(lower, 0);
+			Vector3 maxP(upper, 0);
 
 			if (sketchMode == SKETCHING_SPHERES) {
 				Vector3 center = minP + 0.5*(maxP - minP);
@@ -159,103 +219,161 @@ void App::onUserInput(UserInput *userInput) {
 			else {
 				float rad = (maxP - minP).length() / 2.0;
 				if (rad < 100) {
-					Array<Vector2> polyline;
-					Vector3 previousPoint;
-					for (int x=0; x<sketched3DPath.size(); x++) {
-						if (x==0 || (previousPoint-sketched3DPath[x]).magnitude() > 0.1) {
-							polyline.append(sketched3DPath[x].xy());
-							previousPoint = sketched3DPath[x];
+					Array<Vector2> denseline;
+					Vector2 previousPoint;
+					for (int x=0; x<sketched2DPath.size(); x++) {
+						if (x==0 || (previousPoint-sketched2DPath[x]).magnitude() > 0.1) {
+							denseline.append(sketched2DPath[x]);
+							previousPoint = sketched2DPath[x];
 						}
 					}
+					// Every chain edge is a broadphase proxy, so drop points that would not be visible
+					Array<Vector2> polyline;
+					simplifyPath(denseline, SIMPLIFY_TOLERANCE_PIXELS * worldUnitsPerPixel(sketchedPath[0]), polyline);
                     addPolyline(polyline);
 					// TODO: add this background shape to the physics simulation
-					backgroundShapes.append(PolylineRenderer(polyline));
+					PolylineRenderer(polyline, true).appendTo(backgroundShapes);
 				}
 			}
 
-			sketchedPath.clear();
+			strokeCapture.clear();
+			sketchBuffer.clear();
 		}
 	}
 }
 
+void App::onCleanup() {
+	setThreadedSimulation(false);
+	GApp::onCleanup();
+}
+
 void App::addCircle(Vector3 position, float radius) {
-    SimCircle simCircle;
-    b2BodyDef bodyDef;
-    bodyDef.type = b2_dynamicBody;
-    bodyDef.position.Set(position.x, position.y);
-    simCircle.body = world->CreateBody(&bodyDef);
-    simCircle.radius = radius;
-
-    b2CircleShape circle;
-    circle.m_radius = radius;
-    b2FixtureDef fixtureDef;
-    fixtureDef.shape = &circle;
-    fixtureDef.density = .2f;
-    fixtureDef.friction = .3f;
-    fixtureDef.restitution = 0.3f;
-    simCircle.body->CreateFixture(&fixtureDef);
-
-    circles.append(simCircle);
+    SimulationCommand command;
+    command.type = SimulationCommand::ADD_CIRCLE;
+    command.position = position.xy();
+    command.width = radius;
+    post(command);
 }
 
 void App::addBox(Vector3 position, float width, float height){
-    
-    SimBox simBox;
-    b2BodyDef bodyDef;
-    bodyDef.type = b2_dynamicBody;
-    bodyDef.position.Set(position.x, position.y);
-    simBox.body = world->CreateBody(&bodyDef);
-    simBox.width = width;
-    simBox.height = height;
-    
-    b2PolygonShape boxShape;
-    boxShape.SetAsBox(width/2, height/2);
-    
-    b2FixtureDef fixtureDef;
-    fixtureDef.shape = &boxShape;
-    fixtureDef.density = .2f;
-    fixtureDef.friction = .3f;
-    fixtureDef.restitution = 0.3f;
-    simBox.body->CreateFixture(&fixtureDef);
-    
-    boxes.append(simBox);
+    SimulationCommand command;
+    command.type = SimulationCommand::ADD_BOX;
+    command.position = position.xy();
+    command.width = width;
+    command.height = height;
+    post(command);
 }
 
-void App::addPolyline(Array<Vector2> verts){
-    int size = verts.size();
-    if (size >=2) {
-        Polyline polyline;
-        b2BodyDef bodyDef;
-        bodyDef.type = b2_staticBody;
-    
-        polyline.body = world->CreateBody(&bodyDef);
-        polyline.size = size;
-        b2Vec2 *vs = new b2Vec2[size];
-        for(int i=0;i<size;i++){
-            vs[i].Set(verts[i].x, verts[i].y);
-        }
-        b2ChainShape chainShape;
-        chainShape.CreateChain(vs, size);
-    
-        b2FixtureDef fixtureDef;
-        fixtureDef.shape = &chainShape;
-        fixtureDef.density = .2f;
-        fixtureDef.friction = .3f;
-        fixtureDef.restitution = 1.0f;
-        polyline.body->CreateFixture(&fixtureDef);
-        polylines.append(polyline);
+void App::addPolyline(const Array<Vector2> &verts){
+    SimulationCommand command;
+    command.type = SimulationCommand::ADD_POLYLINE;
+    command.verts = verts;
+    post(command);
+}
+
+void App::spawnPreset() {
+    SimulationCommand command;
+    command.type = SimulationCommand::ADD_BODIES;
+    const int columns = 60;
+    const int rows = 40;
+    command.spawns.reserve(columns * rows);
+    for (int i=0; i<columns * rows; i++) {
+        BodySpawn spawn;
+        spawn.shape = (i % 2) ? BodySpawn::CIRCLE : BodySpawn::BOX;
+        spawn.position = Vector2(-15 + (i % columns) * 0.5f, 5 + (i / columns) * 0.5f);
+        spawn.width = (spawn.shape == BodySpawn::CIRCLE) ? 0.15f : 0.3f;
+        spawn.height = 0.3f;
+        command.spawns.append(spawn);
     }
+    post(command);
 }
 
 void App::resetWorld() {
-    delete world;
-    world = new b2World(b2Vec2(0, -9.8));
-    circles = Array<SimCircle>();
+    SimulationCommand command;
+    command.type = SimulationCommand::RESET;
+    post(command);
+
+    backgroundShapes.clear();
+    circleLods.fastClear();
+    strokeCapture.clear();
+    sketchBuffer.clear();
+}
+
+// Changes to the world go straight to the simulation, or through the worker's queue when it owns it
+void App::post(const SimulationCommand &command) {
+	if (simulationThread) {
+		simulationThread->post(command);
+	}
+	else {
+		simulation->apply(command);
+	}
+}
+
+void App::setThreadedSimulation(bool enabled) {
+	if (enabled && !simulationThread) {
+		simulationThread.reset(new SimulationThread(simulation));
+		simulationThread->start();
+	}
+	else if (!enabled && simulationThread) {
+		simulationThread->stop();
+		simulationThread.reset();
+	}
+}
+
+// Size of one screen pixel on the z=0 plane, near the given pixel
+float App::worldUnitsPerPixel(const Vector2 &pixel) {
+	Plane plane(Vector3(0,0,1),Vector3(0,0,0));
+	Vector3 a = m_activeCamera->worldRay(pixel.x, pixel.y, renderDevice->viewport()).intersection(plane);
+	Vector3 b = m_activeCamera->worldRay(pixel.x + 1, pixel.y, renderDevice->viewport()).intersection(plane);
+	if (!a.isFinite() || !b.isFinite()) {
+		return 0.01f;
+	}
+	return (b - a).length();
+}
+
+// Tells the simulation which part of the z=0 plane the camera can see, so that
+// only bodies there are put into snapshots and drawn
+void App::updateViewRegion() {
+	SimulationCommand command;
+	command.type = SimulationCommand::SET_VIEW_REGION;
+	command.width = 0;
+	command.height = 0;
+	viewRegionValid = false;
+
+	if (viewCulling) {
+		Rect2D viewport = renderDevice->viewport();
+		Array<Vector2> corners;
+		corners.append(Vector2(viewport.x0(), viewport.y0()), Vector2(viewport.x1(), viewport.y0()),
+			Vector2(viewport.x0(), viewport.y1()), Vector2(viewport.x1(), viewport.y1()));
+		Array<Vector2> groundCorners;
+		Vector2 minP, maxP;
+		bool finite = unprojectToGround(screenToWorldMatrix(*m_activeCamera, viewport), viewport, corners, groundCorners, minP, maxP);
+
+		// A corner above the horizon sees the plane out to infinity, so draw everything then.
+		// The margin covers interpolating from the previous step's position.
+		if (finite) {
+			const float margin = 0.5f;
+			command.position = minP - Vector2(margin, margin);
+			command.width = maxP.x - minP.x + 2 * margin;
+			command.height = maxP.y - minP.y + 2 * margin;
+			viewRegionValid = true;
+			viewLower = command.position;
+			viewUpper = command.position + Vector2(command.width, command.height);
+		}
+	}
+	post(command);
 }
 
 void App::onSimulation(RealTime rdt, SimTime sdt, SimTime idt) {
 	GApp::onSimulation(rdt, sdt, idt);
-    world->Step(1/60.0, 6, 2);
+
+	updateViewRegion();
+	if (!simulationThread) {
+		// sdt is G3D's fixed step, not the time that passed; the accumulator needs
+		// wall-clock time, like SimulationThread measures in threaded mode
+		simulation->advance(rdt);
+		simulation->snapshot(localSnapshot, System::time());
+	}
 }
 
 
@@ -265,6 +383,9 @@ void App::reloadShaders() {
 
 	shader = Shader::fromFiles(VERTEX_SHADER, FRAGMENT_SHADER);
 	backgroundShader = Shader::fromFiles(BACKGROUND_VERTEX_SHADER, BACKGROUND_FRAGMENT_SHADER);
+	// The debug overlay's shaders sit next to the main ones
+	debugShader = Shader::fromFiles(FilePath::concat(FilePath::parent(VERTEX_SHADER), "debug.vrt"),
+	                                FilePath::concat(FilePath::parent(VERTEX_SHADER), "debug.pix"));
 }
 
 
@@ -316,30 +437,140 @@ void App::onGraphics3D(RenderDevice* rd, Array<shared_ptr<Surface> >& surface3D)
 	// TODO: you should change this to draw physics objects instead of stationary objects  
 	
 
-    // render circles
-    for (int x=0; x<circles.size(); x++) {
-        
-        b2Vec2 pos2 = circles[x].body->GetPosition();
-        float radius = circles[x].radius;
-        Vector3 pos3(pos2.x, pos2.y, 0);
-        createGeometryAndSetArgs(Sphere(pos3, radius), Color3(0.20,0.79,0.20), args);
-        rd->apply(shader, args);
-    
+    // Bodies are drawn part way between the last two physics steps
+    const WorldSnapshot &snapshot = simulationThread ? simulationThread->latestSnapshot() : localSnapshot;
+    float alpha = snapshot.alpha(System::time());
+    Vector2 position;
+    float angle;
+
+    // Circles pick a sphere LOD from their radius in pixels, which is their radius
+    // times pixelsPerUnit divided by their distance along the view direction
+    const CoordinateFrame &eye = activeCamera()->frame();
+    Vector3 ahead = eye.translation + eye.lookVector();
+    float pixelsPerUnit = (activeCamera()->project(ahead + eye.rightVector(), rd->viewport()).xy() -
+                           activeCamera()->project(ahead, rd->viewport()).xy()).length();
+
+    if (instancedRendering) {
+        // Gather every awake body's transform into one per-instance buffer per shape kind and
+        // sphere LOD. The sleeping bodies' batches are left alone unless the snapshot's
+        // sleeping set changed, or, for circles, the camera moved and their LODs may have.
+        for (int lod=0; lod<MeshCache::SPHERE_LODS; lod++) {
+            circleInstances[AWAKE][lod].clear();
+        }
+        for (int x=0; x<snapshot.circles.size(); x++) {
+            const BodySnapshot &c = snapshot.circles[x];
+            interpolateTransform(c, alpha, position, angle);
+            float depth = G3D::max((Vector3(position, 0) - eye.translation).dot(eye.lookVector()), 0.001f);
+            int lod = circleLod(c, c.size.x * pixelsPerUnit / depth);
+            circleInstances[AWAKE][lod].append(position, angle, Vector3(c.size.x, c.size.x, c.size.x), CIRCLE_COLOR);
+        }
+        const bool sleepersChanged = snapshot.sleepingGeneration != drawnSleepingGeneration;
+        if (sleepersChanged || eye != sleepingLodEye || pixelsPerUnit != sleepingLodPixelsPerUnit) {
+            sleepingLodEye = eye;
+            sleepingLodPixelsPerUnit = pixelsPerUnit;
+            for (int lod=0; lod<MeshCache::SPHERE_LODS; lod++) {
+                circleInstances[ASLEEP][lod].clear();
+            }
+            for (int x=0; x<snapshot.sleepingCircles.size(); x++) {
+                const BodySnapshot &c = snapshot.sleepingCircles[x];
+                float depth = G3D::max((Vector3(c.position, 0) - eye.translation).dot(eye.lookVector()), 0.001f);
+                int lod = circleLod(c, c.size.x * pixelsPerUnit / depth);
+                circleInstances[ASLEEP][lod].append(c.position, c.angle, Vector3(c.size.x, c.size.x, c.size.x), CIRCLE_COLOR);
+            }
+            for (int lod=0; lod<MeshCache::SPHERE_LODS; lod++) {
+                circleInstances[ASLEEP][lod].upload();
+            }
+        }
+
+        boxInstances[AWAKE].clear();
+        for (int i=0; i<snapshot.boxes.size(); i++) {
+            const BodySnapshot &b = snapshot.boxes[i];
+            interpolateTransform(b, alpha, position, angle);
+            boxInstances[AWAKE].append(position, angle, Vector3(b.size.x, b.size.y, 0.4), BOX_COLOR);
+        }
+        if (sleepersChanged) {
+            boxInstances[ASLEEP].clear();
+            for (int i=0; i<snapshot.sleepingBoxes.size(); i++) {
+                const BodySnapshot &b = snapshot.sleepingBoxes[i];
+                boxInstances[ASLEEP].append(b.position, b.angle, Vector3(b.size.x, b.size.y, 0.4), BOX_COLOR);
+            }
+            boxInstances[ASLEEP].upload();
+        }
+        drawnSleepingGeneration = snapshot.sleepingGeneration;
+
+        // The instance transform is applied in vert.vrt, so the object-to-world matrix stays identity
+        Args instancedArgs = args;
+        instancedArgs.setMacro("INSTANCED", 1);
+        for (int lod=0; lod<MeshCache::SPHERE_LODS; lod++) {
+            circleInstances[AWAKE][lod].upload();
+            for (int state=0; state<2; state++) {
+                if (circleInstances[state][lod].size()) {
+                    meshCache->setSphereArgs(instancedArgs, lod);
+                    circleInstances[state][lod].setArgs(instancedArgs);
+                    rd->apply(shader, instancedArgs);
+                }
+            }
+        }
+        boxInstances[AWAKE].upload();
+        for (int state=0; state<2; state++) {
+            if (boxInstances[state].size()) {
+                meshCache->setBoxArgs(instancedArgs);
+                boxInstances[state].setArgs(instancedArgs);
+                rd->apply(shader, instancedArgs);
+            }
+        }
     }
- 
-	for (int i=0;i<boxes.size();i++) {
-        b2Vec2 pos2 = boxes[i].body->GetPosition();
-        float width = boxes[i].width;
-        float height = boxes[i].height;
-        
-        Vector3 minP = Vector3(pos2.x - (width / 2), pos2.y - (height / 2), -0.2);
-        Vector3 maxP = Vector3(pos2.x + (width / 2), pos2.y + (height / 2), 0.2);
+    else {
+        // render circles, awake ones first
+        args.setUniform("objectColor", CIRCLE_COLOR);
+        for (int x=0; x<snapshot.circles.size() + snapshot.sleepingCircles.size(); x++) {
+            
+            const BodySnapshot &c = (x < snapshot.circles.size()) ? snapshot.circles[x] : snapshot.sleepingCircles[x - snapshot.circles.size()];
+            interpolateTransform(c, alpha, position, angle);
+            float radius = c.size.x;
+            float depth = G3D::max((Vector3(position, 0) - eye.translation).dot(eye.lookVector()), 0.001f);
+            meshCache->setSphereArgs(args, circleLod(c, radius * pixelsPerUnit / depth));
+            rd->setObjectToWorldMatrix(bodyFrame(position, angle));
+            args.setUniform("objectScale", Vector3(radius, radius, radius));
+            rd->apply(shader, args);
         
-		createGeometryAndSetArgs(Box(minP, maxP), Color3(0.44,0.52,0.93), args);
-		rd->apply(shader, args);
+        }
+     
+        meshCache->setBoxArgs(args);
+        args.setUniform("objectColor", BOX_COLOR);
+        for (int i=0;i<snapshot.boxes.size() + snapshot.sleepingBoxes.size();i++) {
+            const BodySnapshot &b = (i < snapshot.boxes.size()) ? snapshot.boxes[i] : snapshot.sleepingBoxes[i - snapshot.boxes.size()];
+            interpolateTransform(b, alpha, position, angle);
+            float width = b.size.x;
+            float height = b.size.y;
+            
+            rd->setObjectToWorldMatrix(bodyFrame(position, angle));
+            args.setUniform("objectScale", Vector3(width, height, 0.4));
+            rd->apply(shader, args);
+        }
+    }
+
+	// Polylines and the sketched path have their geometry in world space
+	rd->setObjectToWorldMatrix(CoordinateFrame());
+	args.setUniform("objectScale", Vector3(1, 1, 1));
+	args.setUniform("objectColor", Color3::white());
+	if (backgroundShapes.size() && (!viewRegionValid || backgroundShapes.overlaps(viewLower, viewUpper))) {
+		Args backgroundArgs = args;
+		backgroundArgs.setMacro("UNIFORM_COLOR", 1);
+		backgroundArgs.setUniform("objectColor", BACKGROUND_COLOR);
+		backgroundShapes.setArgs(backgroundArgs);
+		rd->apply(shader, backgroundArgs);
 	}
-	for (int i=0;i<backgroundShapes.size();i++) {
-		backgroundShapes[i].draw(rd, shader, args);
+
+	// The world belongs to the worker thread in threaded mode, so there is nothing to ask then
+	if (physicsDebugMode != 0 && !simulationThread) {
+		simulation->drawDebugData(&physicsDebugDraw);
+		rd->pushState();
+		rd->setObjectToWorldMatrix(CoordinateFrame());
+		rd->setDepthTest(RenderDevice::DEPTH_ALWAYS_PASS);
+		rd->setBlendFunc(RenderDevice::BLEND_SRC_ALPHA, RenderDevice::BLEND_ONE_MINUS_SRC_ALPHA, RenderDevice::BLENDEQ_ADD);
+		physicsDebugDraw.flush(rd, debugShader);
+		rd->popState();
 	}
 	
 
@@ -369,23 +600,12 @@ void App::onGraphics3D(RenderDevice* rd, Array<shared_ptr<Surface> >& surface3D)
 
 	// FOURTH: Draw the 2D path that the mouse sketched on the screen
 	rd->push2D();
-	Array<Vector3> normals;
-	Array<Color3> colors;
-	Array<int> indices;
-	Vector3 normal(0,0,1);
-	for (int i=0;i<sketchedPath.size();i++) {
-		normals.append(normal);
-		colors.append(Color3::black());
-		indices.append(i);
+	sketchBuffer.update(strokeCapture.points());
+	if (sketchBuffer.size()) {
+		args.clearAttributeAndIndexBindings();
+		sketchBuffer.setArgs(args);
+		rd->apply(shader, args);
 	}
-	shared_ptr<VertexBuffer> vdatabuf = VertexBuffer::create((sizeof(Vector3)+sizeof(Vector3)+sizeof(Color3))*sketchedPath.size(), VertexBuffer::WRITE_ONCE);
-	shared_ptr<VertexBuffer> vindexbuf = VertexBuffer::create(sizeof(int)*sketchedPath.size(), VertexBuffer::WRITE_ONCE);
-	args.setAttributeArray("g3d_Vertex", AttributeArray(sketchedPath, vdatabuf));
-	args.setAttributeArray("g3d_Normal", AttributeArray(normals, vdatabuf));
-	args.setAttributeArray("color", AttributeArray(colors, vdatabuf));
-	args.setPrimitiveType(PrimitiveType::LINE_STRIP);
-	args.setIndexStream(IndexStream(indices, vindexbuf));
-	rd->apply(shader, args);
 	rd->pop2D();
 
 
@@ -394,91 +614,23 @@ void App::onGraphics3D(RenderDevice* rd, Array<shared_ptr<Surface> >& surface3D)
 }
 
 
-void App::onGraphics2D(RenderDevice* rd, Array<Surface2D::Ref>& posed2D) {
-	Surface2D::sortAndRender(rd, posed2D);
-}
-
-void App::createGeometryAndSetArgs(const Box &b, Color3 color, Args &args) {
-
-	Array<Vector3> vertices;
-	Array<Vector3> normals;
-	Array<Color3> colors;
-	Array<int> indices;
-	for (int i = 0; i < 6; ++i) {
-        Vector3 v0, v1, v2, v3;
-        b.getFaceCorners(i, v0, v1, v2, v3);
-
-        Vector3 n = (v1 - v0).cross(v3 - v0);
-		n = n.unit();
-        vertices.append(v0, v1, v2, v0, v2, v3);
-		normals.append(n, n, n, n, n, n);
-		int base = indices.size();
-		indices.append(base, base+1, base+2, base+3, base+4, base+5);
-		colors.append(color, color, color, color, color, color);
-    }
-	shared_ptr<VertexBuffer> vdatabuf = VertexBuffer::create((sizeof(Vector3)+sizeof(Vector3)+sizeof(Color3))*vertices.size(), VertexBuffer::WRITE_ONCE);
-	shared_ptr<VertexBuffer> vindexbuf = VertexBuffer::create(sizeof(int)*indices.size(), VertexBuffer::WRITE_ONCE);
-	args.setAttributeArray("g3d_Vertex", AttributeArray(vertices, vdatabuf));
-	args.setAttributeArray("g3d_Normal", AttributeArray(normals, vdatabuf));
-	args.setAttributeArray("color", AttributeArray(colors, vdatabuf));
-	args.setPrimitiveType(PrimitiveType::TRIANGLES);
-	args.setIndexStream(IndexStream(indices, vindexbuf));
+// Chooses the sphere LOD for a circle, remembering it so the next frame's choice has hysteresis
+int App::circleLod(const BodySnapshot &circle, float projectedRadius) {
+	while (circleLods.size() <= circle.id) {
+		circleLods.append(0);
+	}
+	int lod = meshCache->sphereLod(projectedRadius, circleLods[circle.id]);
+	circleLods[circle.id] = (uint8)lod;
+	return lod;
 }
 
-void App::createGeometryAndSetArgs(const Sphere &s, Color3 color, Args &args) {
-	Array<Vector3> vertices;
-	Array<Vector3> normals;
-	Array<Color3> colors;
-	Array<int> indices;
-	
-	const int SLICES = 40;
-	const int STACKS = 20;
-	for (int p = 0; p < STACKS; ++p) {
-        const float pitch0 = p * (float)pi() / (STACKS);
-        const float pitch1 = (p + 1) * (float)pi() / (STACKS);
-
-        const float sp0 = sin(pitch0);
-        const float sp1 = sin(pitch1);
-        const float cp0 = cos(pitch0);
-        const float cp1 = cos(pitch1);
-
-        for (int y = 0; y <= SLICES; ++y) {
-            const float yaw = -y * (float)twoPi() / SLICES;
-
-            const float cy = cos(yaw);
-            const float sy = sin(yaw);
-
-			Vector3 v0(cy * sp0, cp0, sy * sp0);
-            Vector3 v1(cy * sp1, cp1, sy * sp1);
-			normals.append(v0.unit(), v1.unit());
-			v0 = (s.radius*v0) + s.center;
-			v1 = (s.radius*v1) + s.center;
-
-            vertices.append(v0, v1);
-			colors.append(color, color);
-                    
-        }
-
-        Vector3 degen(1.0f * sp1, cp1, 0.0f * sp1);
-		degen = (s.radius*degen)+s.center;
-        vertices.append(degen, degen);
-		normals.append(degen, degen);
-		colors.append(color, color);
-                  
-    }
-
-	for(int i=0; i < vertices.size(); i++){
-		indices.append(i);
+void App::onGraphics2D(RenderDevice* rd, Array<Surface2D::Ref>& posed2D) {
+	if (showMemoryStats) {
+		const WorldSnapshot &snapshot = simulationThread ? simulationThread->latestSnapshot() : localSnapshot;
+		screenPrintf("Scratch arena: %d bytes reserved, %d peak, %d growths",
+			(int)snapshot.scratchReserved, (int)snapshot.scratchPeak, snapshot.scratchGrowths);
 	}
-
-	shared_ptr<VertexBuffer> vdatabuf = VertexBuffer::create((sizeof(Vector3)+sizeof(Vector3)+sizeof(Color3))*vertices.size(), VertexBuffer::WRITE_ONCE);
-	shared_ptr<VertexBuffer> vindexbuf = VertexBuffer::create(sizeof(int)*indices.size(), VertexBuffer::WRITE_ONCE);
-	args.setAttributeArray("g3d_Vertex", AttributeArray(vertices, vdatabuf));
-	args.setAttributeArray("g3d_Normal", AttributeArray(normals, vdatabuf));
-	args.setAttributeArray("color", AttributeArray(colors, vdatabuf));
-	args.setPrimitiveType(PrimitiveType::TRIANGLE_STRIP);
-	args.setIndexStream(IndexStream(indices, vindexbuf));
+	Surface2D::sortAndRender(rd, posed2D);
 }
 
 
-
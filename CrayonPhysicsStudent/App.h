@@ -4,25 +4,16 @@
 #include <G3D/G3DAll.h>
 #include "TurntableManipulator.h"
 #include "PolyLineRenderer.h"
-#include <Box2D/Box2D.h>
-
-
-struct SimCircle {
-    float radius;
-    b2Body *body;
-};
-
-struct SimBox {
-    float width;
-    float height;
-    b2Body *body;
-};
-
-struct Polyline {
-    int size;
-    //Array<Vector2> verts;
-    b2Body *body;
-};
+#include "MeshCache.h"
+#include "InstanceBatch.h"
+#include "StrokeBuffer.h"
+#include "StrokeCapture.h"
+#include "StaticGeometryBatch.h"
+#include "PathSimplifier.h"
+#include "ScreenProjection.h"
+#include "Simulation.h"
+#include "SimulationThread.h"
+#include "PhysicsDebugDraw.h"
 
 class App : public GApp {
 public:
@@ -36,24 +27,39 @@ public:
 
 	virtual bool onEvent(const GEvent& e);
 	virtual void onUserInput(UserInput *userInput);
+	virtual void onCleanup();
 
 protected:
     
-    b2World *world;
-    
-    Array<SimCircle> circles;
-    Array<SimBox> boxes;
-    Array<Polyline> polylines;
-    
+    // The physics world. While simulationThread exists it owns the simulation and
+    // the UI only talks to it through commands; otherwise onSimulation steps it.
+    shared_ptr<Simulation> simulation;
+    shared_ptr<SimulationThread> simulationThread;
+    // Body state drawn when the simulation runs on this thread
+    WorldSnapshot localSnapshot;
 
     virtual void addCircle(Vector3 position, float radius);
     virtual void addBox(Vector3 position, float width, float height);
-    virtual void addPolyline(Array<Vector2> verts);
+    virtual void addPolyline(const Array<Vector2> &verts);
+    // Drops a grid of circles and boxes into the scene as a single ADD_BODIES command
+    virtual void spawnPreset();
     virtual void resetWorld();;
+    virtual void post(const SimulationCommand &command);
+    virtual void setThreadedSimulation(bool enabled);
+    virtual void updateViewRegion();
+
+    // When true only bodies and background shapes inside the camera's view of the
+    // z=0 plane are drawn. Press V to toggle.
+    bool viewCulling;
+    // When true, bodies that fall far outside the scene are destroyed. Press K to toggle.
+    bool killVolume;
+    // Visible part of the z=0 plane, when viewRegionValid
+    bool viewRegionValid;
+    Vector2 viewLower;
+    Vector2 viewUpper;
     
 	virtual void reloadShaders();
-	virtual void createGeometryAndSetArgs(const Box &b, Color3 color, Args &args);
-	virtual void createGeometryAndSetArgs(const Sphere &s, Color3 color, Args &args);
+	virtual float worldUnitsPerPixel(const Vector2 &pixel);
 
 	shared_ptr<Texture> diffuseRamp;
 	shared_ptr<Texture> specularRamp;
@@ -62,8 +68,38 @@ protected:
 	shared_ptr<Texture> menuTex;  
 
 	shared_ptr<Shader> backgroundShader;
+	shared_ptr<Shader> debugShader;
 	shared_ptr<Shader> shader;
 
+	// Unit sphere and box meshes, uploaded once in onInit
+	shared_ptr<MeshCache> meshCache;
+
+	// When true, all circles are drawn with one instanced call and all boxes with
+	// another; otherwise each body gets its own draw call. Press I to toggle.
+	bool instancedRendering;
+	// Indexed first by whether the bodies are awake. Sleeping bodies don't move, so their
+	// batches are only rebuilt and uploaded when WorldSnapshot::sleepingGeneration changes.
+	InstanceBatch circleInstances[2][MeshCache::SPHERE_LODS];
+	InstanceBatch boxInstances[2];
+	// sleepingGeneration of the snapshot the sleeping batches were built from
+	int drawnSleepingGeneration;
+	// Camera the sleeping circles' LODs were picked for
+	CoordinateFrame sleepingLodEye;
+	float sleepingLodPixelsPerUnit;
+
+	// Sphere LOD each circle was last drawn with, indexed by BodySnapshot::id
+	Array<uint8> circleLods;
+	virtual int circleLod(const BodySnapshot &circle, float projectedRadius);
+
+	// Box2D's own view of the world, drawn over the scene. Press D to cycle through
+	// off, shapes, and shapes with broadphase AABBs. Not available while the
+	// simulation runs on its own thread.
+	int physicsDebugMode;
+	PhysicsDebugDraw physicsDebugDraw;
+
+	// Press M to show the simulation's scratch memory use
+	bool showMemoryStats;
+
 	AttributeArray backgroundVerts;
 	IndexStream	backgroundIndices;
 
@@ -75,11 +111,14 @@ protected:
 		SKETCHING_BOXES = 2
 	};
 	SketchMode              sketchMode;
-	Array<Vector2>          sketchedPath;  
+	// Mouse path of the stroke being drawn, sampled by distance from every mouse event
+	StrokeCapture           strokeCapture;
+	StrokeBuffer            sketchBuffer;
 
 	//Array<Sphere>           spheres;
 	//Array<Box>              boxes;
-	Array< PolylineRenderer > backgroundShapes;
+	// Every background shape, drawn with one call
+	StaticGeometryBatch backgroundShapes;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "BodyTable.h"
+
+BodyTable::BodyTable() : awakeCount(0) {
+}
+
+int BodyTable::add(b2Body *body, int id, const Vector2 &size) {
+	int handle;
+	if (freeHandles.size()) {
+		handle = freeHandles.pop();
+	} else {
+		handle = rowOfHandle.size();
+		rowOfHandle.append(-1);
+	}
+	rowOfHandle[handle] = bodies.size();
+
+	const Vector2 position(body->GetPosition().x, body->GetPosition().y);
+	bodies.append(body);
+	handles.append(handle);
+	ids.append(id);
+	sizes.append(size);
+	previousPositions.append(position);
+	previousAngles.append(body->GetAngle());
+	positions.append(position);
+	angles.append(body->GetAngle());
+	if (body->IsAwake()) {
+		swapRows(bodies.size() - 1, awakeCount);
+		awakeCount++;
+	}
+	return handle;
+}
+
+void BodyTable::reserve(int rows) {
+	bodies.reserve(rows);
+	handles.reserve(rows);
+	ids.reserve(rows);
+	sizes.reserve(rows);
+	previousPositions.reserve(rows);
+	previousAngles.reserve(rows);
+	positions.reserve(rows);
+	angles.reserve(rows);
+	rowOfHandle.reserve(rows);
+}
+
+void BodyTable::removeRow(int row) {
+	rowOfHandle[handles[row]] = -1;
+	freeHandles.append(handles[row]);
+
+	// Move the row to the end without mixing awake and sleeping rows, then drop it
+	if (row < awakeCount) {
+		awakeCount--;
+		swapRows(row, awakeCount);
+		row = awakeCount;
+	}
+	const int last = bodies.size() - 1;
+	swapRows(row, last);
+
+	bodies.fastRemove(last);
+	handles.fastRemove(last);
+	ids.fastRemove(last);
+	sizes.fastRemove(last);
+	previousPositions.fastRemove(last);
+	previousAngles.fastRemove(last);
+	positions.fastRemove(last);
+	angles.fastRemove(last);
+}
+
+void BodyTable::swapRows(int a, int b) {
+	if (a == b) {
+		return;
+	}
+	std::swap(bodies[a], bodies[b]);
+	std::swap(handles[a], handles[b]);
+	std::swap(ids[a], ids[b]);
+	std::swap(sizes[a], sizes[b]);
+	std::swap(previousPositions[a], previousPositions[b]);
+	std::swap(previousAngles[a], previousAngles[b]);
+	std::swap(positions[a], positions[b]);
+	std::swap(angles[a], angles[b]);
+
+	// A removed row's handle is already free, so only live handles are updated
+	if (rowOfHandle[handles[a]] >= 0) {
+		rowOfHandle[handles[a]] = a;
+	}
+	if (rowOfHandle[handles[b]] >= 0) {
+		rowOfHandle[handles[b]] = b;
+	}
+}
+
+void BodyTable::clear() {
+	bodies.fastClear();
+	handles.fastClear();
+	ids.fastClear();
+	sizes.fastClear();
+	previousPositions.fastClear();
+	previousAngles.fastClear();
+	positions.fastClear();
+	angles.fastClear();
+	rowOfHandle.fastClear();
+	freeHandles.fastClear();
+	awakeCount = 0;
+}
+
+void BodyTable::savePrevious() {
+	for (int i = 0; i < awakeCount; i++) {
+		previousPositions[i] = positions[i];
+		previousAngles[i] = angles[i];
+	}
+}
+
+int BodyTable::sweep() {
+	int fellAsleep = 0;
+	for (int i = 0; i < awakeCount; ) {
+		const b2Body *body = bodies[i];
+		const b2Vec2 &p = body->GetPosition();
+		positions[i] = Vector2(p.x, p.y);
+		angles[i] = body->GetAngle();
+		if (body->IsAwake()) {
+			i++;
+			continue;
+		}
+		// Sleeping bodies are drawn where they stopped, without interpolation
+		previousPositions[i] = positions[i];
+		previousAngles[i] = angles[i];
+		// The row swapped in from the end of the awake ones still has to be read
+		awakeCount--;
+		swapRows(i, awakeCount);
+		fellAsleep++;
+	}
+	return fellAsleep;
+}
+
+int BodyTable::wake(int row) {
+	swapRows(row, awakeCount);
+	row = awakeCount;
+	awakeCount++;
+
+	// The stored transform is where it slept, which is where this step started from
+	const b2Body *body = bodies[row];
+	const b2Vec2 &p = body->GetPosition();
+	previousPositions[row] = positions[row];
+	previousAngles[row] = angles[row];
+	positions[row] = Vector2(p.x, p.y);
+	angles[row] = body->GetAngle();
+	return row;
+}
@@ -0,0 +1,74 @@
+#ifndef BodyTable_h
+#define BodyTable_h
+
+#include <G3D/G3DAll.h>
+#include <Box2D/Box2D.h>
+
+// The bodies of one kind, stored as a structure of arrays: row i of every column
+// belongs to the same body, and rows are packed, so a pass over all the bodies is a
+// linear scan of a few arrays instead of a walk through b2Bodies. Removing a body
+// moves the last row into its place, so anything outside the table (such as
+// b2Body user data) refers to bodies by handle, which stays valid until removal.
+// The awake bodies are kept in the first rows, so stepping only touches them and
+// the sleeping rows stay as they are until something wakes them.
+class BodyTable {
+public:
+	BodyTable();
+
+	// Adds a row for body, with its transform read from it, and returns the row's handle
+	int add(b2Body *body, int id, const Vector2 &size);
+
+	// Removes a row in O(1). Does not destroy the b2Body.
+	void removeRow(int row);
+
+	// Makes room for the given number of rows without reallocating any column
+	void reserve(int rows);
+
+	// Removes every row but keeps the storage
+	void clear();
+
+	int size() const { return bodies.size(); }
+
+	int row(int handle) const { return rowOfHandle[handle]; }
+
+	// Rows [0, awakeSize()) hold the awake bodies, the rest the sleeping ones
+	int awakeSize() const { return awakeCount; }
+	bool isAwake(int row) const { return row < awakeCount; }
+
+	// Copies the awake bodies' transforms to the previous ones; called before each step
+	void savePrevious();
+
+	// Reads the awake bodies' positions and angles into the columns in one pass, and
+	// moves the ones Box2D put to sleep behind them. Called after each step; returns
+	// how many bodies fell asleep.
+	int sweep();
+
+	// Moves a sleeping row that Box2D woke during the last step in with the awake ones
+	// and reads its transform. Returns the row it ends up in.
+	int wake(int row);
+
+	Array<b2Body*> bodies;
+	Array<int> handles;
+	// Unique within the current world, and never reused until the world is reset
+	Array<int> ids;
+	// (radius, radius) for circles, (width, height) for boxes
+	Array<Vector2> sizes;
+	// Transform after the previous physics step, used to interpolate rendering
+	Array<Vector2> previousPositions;
+	Array<float> previousAngles;
+	// Transform after the latest step
+	Array<Vector2> positions;
+	Array<float> angles;
+
+protected:
+	// Exchanges two rows in every column
+	void swapRows(int a, int b);
+
+	int awakeCount;
+
+	// Row of every handle handed out; -1 once the handle is on freeHandles
+	Array<int> rowOfHandle;
+	Array<int> freeHandles;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#include "GrowableVertexBuffer.h"
+
+// Room for the alignment padding VertexBuffer inserts between attribute arrays
+static const size_t BUFFER_PADDING = 64;
+
+GrowableVertexBuffer::GrowableVertexBuffer(VertexBuffer::UsageHint hint, int minCapacity, int growthLimit) :
+	hint(hint), minCapacity(minCapacity), growthLimit(growthLimit), elementCapacity(0) {
+}
+
+void GrowableVertexBuffer::grow(int count, size_t elementBytes) {
+	int grown = G3D::max(minCapacity, 2 * elementCapacity);
+	if (count <= growthLimit) {
+		grown = G3D::min(grown, growthLimit);
+	}
+	elementCapacity = G3D::max(grown, count);
+	vbuf = VertexBuffer::create(elementBytes * elementCapacity + BUFFER_PADDING, hint);
+}
+
+void GrowableVertexBuffer::refill(int count, size_t elementBytes) {
+	if (count > elementCapacity) {
+		grow(count, elementBytes);
+	} else {
+		vbuf->reset();
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef GrowableVertexBuffer_h
+#define GrowableVertexBuffer_h
+
+#include <G3D/G3DAll.h>
+#include <climits>
+
+// A VertexBuffer sized in elements that is only ever replaced by a bigger one.
+// Capacity at least doubles each time, so a buffer that is refilled every frame
+// or appended to a piece at a time is reallocated O(log n) times.
+class GrowableVertexBuffer {
+public:
+	// Capacity never grows to less than minCapacity. Doubling alone never takes it
+	// past growthLimit; once a count does, it doubles as usual from there.
+	GrowableVertexBuffer(VertexBuffer::UsageHint hint, int minCapacity = 0, int growthLimit = INT_MAX);
+
+	// Replaces the buffer with an empty one with room for at least count elements
+	// of elementBytes each. Everything in use has to be uploaded again.
+	void grow(int count, size_t elementBytes);
+
+	// Empties the buffer for a fresh upload of count elements, growing it first if they don't fit
+	void refill(int count, size_t elementBytes);
+
+	int capacity() const { return elementCapacity; }
+
+	const shared_ptr<VertexBuffer> &buffer() const { return vbuf; }
+
+protected:
+	VertexBuffer::UsageHint hint;
+	int minCapacity;
+	int growthLimit;
+	int elementCapacity;
+
+	shared_ptr<VertexBuffer> vbuf;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#include "InstanceBatch.h"
+
+InstanceBatch::InstanceBatch() : vdatabuf(VertexBuffer::WRITE_EVERY_FRAME) {
+}
+
+void InstanceBatch::clear() {
+	transforms.fastClear();
+	scales.fastClear();
+	colors.fastClear();
+}
+
+void InstanceBatch::append(const Vector2 &position, float angle, const Vector3 &scale, const Color3 &color) {
+	transforms.append(Vector4(position.x, position.y, cosf(angle), sinf(angle)));
+	scales.append(scale);
+	colors.append(color);
+}
+
+void InstanceBatch::upload() {
+	if (transforms.size() == 0) {
+		return;
+	}
+
+	vdatabuf.refill(transforms.size(), sizeof(Vector4) + sizeof(Vector3) + sizeof(Color3));
+	vtransforms = AttributeArray(transforms, vdatabuf.buffer());
+	vscales = AttributeArray(scales, vdatabuf.buffer());
+	vcolors = AttributeArray(colors, vdatabuf.buffer());
+}
+
+void InstanceBatch::setArgs(Args &args) const {
+	args.setAttributeArray("instanceTransform", vtransforms, true);
+	args.setAttributeArray("instanceScale", vscales, true);
+	args.setAttributeArray("instanceColor", vcolors, true);
+	args.setNumInstances(transforms.size());
+}
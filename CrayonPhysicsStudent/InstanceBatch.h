@@ -0,0 +1,41 @@
+#ifndef InstanceBatch_h
+#define InstanceBatch_h
+
+#include <G3D/G3DAll.h>
+#include "GrowableVertexBuffer.h"
+
+// Per-instance attributes for drawing many copies of one MeshCache mesh with a
+// single draw call. The batch is refilled every frame; its VertexBuffer only
+// grows (geometrically) and is otherwise reused, so uploading N instances costs
+// one buffer write rather than N draw calls. Read by vert.vrt when INSTANCED is set.
+class InstanceBatch {
+public:
+	InstanceBatch();
+
+	void clear();
+	void append(const Vector2 &position, float angle, const Vector3 &scale, const Color3 &color);
+	int size() const { return transforms.size(); }
+
+	// Copies the instances appended since the last clear() to the GPU
+	void upload();
+
+	// Binds the per-instance attributes and instance count; the mesh itself comes from MeshCache
+	void setArgs(Args &args) const;
+
+protected:
+	// The body's b2Transform: xy = position, zw = (cos, sin) of its angle, so the
+	// shader rotates without evaluating trig functions per vertex
+	Array<Vector4> transforms;
+	Array<Vector3> scales;
+	Array<Color3> colors;
+
+	GrowableVertexBuffer vdatabuf;
+
+	AttributeArray vtransforms;
+
+	AttributeArray vscales;
+
+	AttributeArray vcolors;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "MeshCache.h"
+
+// Slices and stacks of each sphere LOD, and the smallest projected radius in pixels it is used for
+static const int LOD_SLICES[MeshCache::SPHERE_LODS] = { 40, 20, 12, 6 };
+static const int LOD_STACKS[MeshCache::SPHERE_LODS] = { 20, 10, 6, 4 };
+static const float LOD_MIN_RADIUS[MeshCache::SPHERE_LODS] = { 60, 20, 6, 0 };
+
+// Fraction past a threshold a sphere must get before it changes LOD
+static const float LOD_HYSTERESIS = 0.15f;
+
+MeshCache::MeshCache() {
+	for (int lod = 0; lod < SPHERE_LODS; lod++) {
+		buildSphere(sphere[lod], LOD_SLICES[lod], LOD_STACKS[lod]);
+	}
+	buildBox();
+}
+
+void MeshCache::setSphereArgs(Args &args, int lod) const {
+	sphere[lod].setArgs(args);
+}
+
+int MeshCache::sphereLod(float projectedRadius, int currentLod) const {
+	int lod = currentLod;
+	// Move to finer meshes once clearly above their thresholds...
+	while (lod > 0 && projectedRadius > LOD_MIN_RADIUS[lod - 1] * (1 + LOD_HYSTERESIS)) {
+		lod--;
+	}
+	// ...and to coarser ones once clearly below the current one's
+	while (lod < SPHERE_LODS - 1 && projectedRadius < LOD_MIN_RADIUS[lod] * (1 - LOD_HYSTERESIS)) {
+		lod++;
+	}
+	return lod;
+}
+
+void MeshCache::setBoxArgs(Args &args) const {
+	box.setArgs(args);
+}
+
+void MeshCache::buildSphere(Mesh &mesh, int slices, int stacks) {
+	Array<Vector3> vertices;
+	Array<Vector3> normals;
+	Array<int> indices;
+
+	for (int p = 0; p < stacks; ++p) {
+		const float pitch0 = p * (float)pi() / (stacks);
+		const float pitch1 = (p + 1) * (float)pi() / (stacks);
+
+		const float sp0 = sin(pitch0);
+		const float sp1 = sin(pitch1);
+		const float cp0 = cos(pitch0);
+		const float cp1 = cos(pitch1);
+
+		for (int y = 0; y <= slices; ++y) {
+			const float yaw = -y * (float)twoPi() / slices;
+
+			const float cy = cos(yaw);
+			const float sy = sin(yaw);
+
+			Vector3 v0(cy * sp0, cp0, sy * sp0);
+			Vector3 v1(cy * sp1, cp1, sy * sp1);
+			normals.append(v0.unit(), v1.unit());
+			vertices.append(v0, v1);
+		}
+
+		Vector3 degen(1.0f * sp1, cp1, 0.0f * sp1);
+		vertices.append(degen, degen);
+		normals.append(degen, degen);
+	}
+
+	for (int i = 0; i < vertices.size(); i++) {
+		indices.append(i);
+	}
+
+	mesh.primitiveType = PrimitiveType::TRIANGLE_STRIP;
+	mesh.upload(vertices, normals, indices);
+}
+
+void MeshCache::buildBox() {
+	Array<Vector3> vertices;
+	Array<Vector3> normals;
+	Array<int> indices;
+
+	Box b(Vector3(-0.5, -0.5, -0.5), Vector3(0.5, 0.5, 0.5));
+	for (int i = 0; i < 6; ++i) {
+		Vector3 v0, v1, v2, v3;
+		b.getFaceCorners(i, v0, v1, v2, v3);
+
+		Vector3 n = (v1 - v0).cross(v3 - v0);
+		n = n.unit();
+		vertices.append(v0, v1, v2, v0, v2, v3);
+		normals.append(n, n, n, n, n, n);
+		int base = indices.size();
+		indices.append(base, base+1, base+2, base+3, base+4, base+5);
+	}
+
+	box.primitiveType = PrimitiveType::TRIANGLES;
+	box.upload(vertices, normals, indices);
+}
+
+void MeshCache::Mesh::upload(const Array<Vector3> &coords, const Array<Vector3> &normals, const Array<int> &indices) {
+	// The per-object color comes from the objectColor uniform, so the mesh itself is white
+	Array<Color3> colors;
+	colors.resize(coords.size());
+	colors.setAll(Color3::white());
+
+	vdatabuf = VertexBuffer::create((sizeof(Vector3)+sizeof(Vector3)+sizeof(Color3))*coords.size(), VertexBuffer::WRITE_ONCE);
+	vindexbuf = VertexBuffer::create(sizeof(int)*indices.size(), VertexBuffer::WRITE_ONCE);
+	vcoords = AttributeArray(coords, vdatabuf);
+	vnormals = AttributeArray(normals, vdatabuf);
+	vcolors = AttributeArray(colors, vdatabuf);
+	vindices = IndexStream(indices, vindexbuf);
+}
+
+void MeshCache::Mesh::setArgs(Args &args) const {
+	args.setAttributeArray("g3d_Vertex", vcoords);
+	args.setAttributeArray("g3d_Normal", vnormals);
+	args.setAttributeArray("color", vcolors);
+	args.setPrimitiveType(primitiveType);
+	args.setIndexStream(vindices);
+}
@@ -0,0 +1,50 @@
+#ifndef MeshCache_h
+#define MeshCache_h
+
+#include <G3D/G3DAll.h>
+
+// Holds the unit sphere and unit box meshes on the GPU so that bodies can be
+// drawn every frame without regenerating or re-uploading vertex data. Each body
+// is drawn with its own object-to-world transform plus the "objectScale" and
+// "objectColor" uniforms read by vert.vrt.
+class MeshCache {
+public:
+	// Must be constructed after the RenderDevice exists (i.e. in App::onInit)
+	MeshCache();
+
+	// Number of sphere tessellations, from finest (0) to coarsest
+	static const int SPHERE_LODS = 4;
+
+	// Sphere of radius 1 centered at the origin, at the given level of detail
+	void setSphereArgs(Args &args, int lod = 0) const;
+
+	// Level of detail for a sphere covering projectedRadius pixels on screen that was last
+	// drawn at currentLod. A sphere has to cross a threshold by a margin before it
+	// switches, so one sitting right at a threshold does not flicker between two meshes.
+	int sphereLod(float projectedRadius, int currentLod) const;
+
+	// Box spanning -0.5..0.5 on each axis
+	void setBoxArgs(Args &args) const;
+
+protected:
+	struct Mesh {
+		shared_ptr<VertexBuffer> vdatabuf;
+		shared_ptr<VertexBuffer> vindexbuf;
+		AttributeArray vcoords;
+		AttributeArray vnormals;
+		AttributeArray vcolors;
+		IndexStream vindices;
+		PrimitiveType primitiveType;
+
+		void upload(const Array<Vector3> &coords, const Array<Vector3> &normals, const Array<int> &indices);
+		void setArgs(Args &args) const;
+	};
+
+	void buildSphere(Mesh &mesh, int slices, int stacks);
+	void buildBox();
+
+	Mesh sphere[SPHERE_LODS];
+	Mesh box;
+};
+
+#endif
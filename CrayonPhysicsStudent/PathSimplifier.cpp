@@ -0,0 +1,59 @@
+#include "PathSimplifier.h"
+
+// Distance from p to the segment a-b
+static float distanceToSegment(const Vector2 &p, const Vector2 &a, const Vector2 &b) {
+	Vector2 ab = b - a;
+	float lengthSquared = ab.squaredLength();
+	if (lengthSquared == 0) {
+		return (p - a).length();
+	}
+	float t = clamp((p - a).dot(ab) / lengthSquared, 0.0f, 1.0f);
+	return (p - (a + ab * t)).length();
+}
+
+void simplifyPath(const Array<Vector2> &points, float tolerance, Array<Vector2> &result) {
+	result.fastClear();
+	if (points.size() <= 2) {
+		result.append(points);
+		return;
+	}
+
+	Array<bool> keep;
+	keep.resize(points.size());
+	keep.setAll(false);
+	keep[0] = true;
+	keep[points.size() - 1] = true;
+
+	// Ranges still to split, as (first, last) index pairs. An explicit stack
+	// keeps long, nearly straight strokes from recursing thousands deep.
+	Array<int> ranges;
+	ranges.append(0, points.size() - 1);
+	while (ranges.size()) {
+		int last = ranges.last();
+		ranges.pop();
+		int first = ranges.last();
+		ranges.pop();
+
+		float farthest = 0;
+		int split = -1;
+		for (int i = first + 1; i < last; i++) {
+			float d = distanceToSegment(points[i], points[first], points[last]);
+			if (d > farthest) {
+				farthest = d;
+				split = i;
+			}
+		}
+
+		if (split >= 0 && farthest > tolerance) {
+			keep[split] = true;
+			ranges.append(first, split);
+			ranges.append(split, last);
+		}
+	}
+
+	for (int i = 0; i < points.size(); i++) {
+		if (keep[i]) {
+			result.append(points[i]);
+		}
+	}
+}
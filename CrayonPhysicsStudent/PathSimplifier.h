@@ -0,0 +1,11 @@
+#ifndef PathSimplifier_h
+#define PathSimplifier_h
+
+#include <G3D/G3DAll.h>
+
+// Ramer-Douglas-Peucker simplification. Writes to result the fewest points of
+// points such that every dropped point lies within tolerance of the simplified
+// polyline. The first and last points are always kept.
+void simplifyPath(const Array<Vector2> &points, float tolerance, Array<Vector2> &result);
+
+#endif
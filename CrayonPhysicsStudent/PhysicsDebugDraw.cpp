@@ -0,0 +1,112 @@
+#include "PhysicsDebugDraw.h"
+
+static const int CIRCLE_SEGMENTS = 16;
+
+// Solid shapes are drawn see-through over the bodies, with a full-strength outline
+static const float FILL_ALPHA = 0.35f;
+
+// Length of the axes drawn by DrawTransform
+static const float AXIS_SCALE = 0.4f;
+
+static Color4 toColor4(const b2Color &color, float alpha) {
+	return Color4(color.r, color.g, color.b, alpha);
+}
+
+// Point i of CIRCLE_SEGMENTS evenly spaced around a circle
+static b2Vec2 circlePoint(const b2Vec2 &center, float32 radius, int i) {
+	const float angle = i * (float)twoPi() / CIRCLE_SEGMENTS;
+	return b2Vec2(center.x + radius * cosf(angle), center.y + radius * sinf(angle));
+}
+
+PhysicsDebugDraw::PhysicsDebugDraw() {
+	SetFlags(e_shapeBit);
+}
+
+void PhysicsDebugDraw::DrawPolygon(const b2Vec2 *vertices, int32 vertexCount, const b2Color &color) {
+	const Color4 c = toColor4(color, 1);
+	for (int i = 0; i < vertexCount; i++) {
+		lines.add(vertices[i], c);
+		lines.add(vertices[(i + 1) % vertexCount], c);
+	}
+}
+
+void PhysicsDebugDraw::DrawSolidPolygon(const b2Vec2 *vertices, int32 vertexCount, const b2Color &color) {
+	// Box2D polygons are convex, so a fan from the first vertex covers them
+	const Color4 fill = toColor4(color, FILL_ALPHA);
+	for (int i = 1; i < vertexCount - 1; i++) {
+		triangles.add(vertices[0], fill);
+		triangles.add(vertices[i], fill);
+		triangles.add(vertices[i + 1], fill);
+	}
+	DrawPolygon(vertices, vertexCount, color);
+}
+
+void PhysicsDebugDraw::DrawCircle(const b2Vec2 &center, float32 radius, const b2Color &color) {
+	const Color4 c = toColor4(color, 1);
+	b2Vec2 previous = circlePoint(center, radius, 0);
+	for (int i = 1; i <= CIRCLE_SEGMENTS; i++) {
+		b2Vec2 next = circlePoint(center, radius, i);
+		lines.add(previous, c);
+		lines.add(next, c);
+		previous = next;
+	}
+}
+
+void PhysicsDebugDraw::DrawSolidCircle(const b2Vec2 &center, float32 radius, const b2Vec2 &axis, const b2Color &color) {
+	const Color4 fill = toColor4(color, FILL_ALPHA);
+	b2Vec2 previous = circlePoint(center, radius, 0);
+	for (int i = 1; i <= CIRCLE_SEGMENTS; i++) {
+		b2Vec2 next = circlePoint(center, radius, i);
+		triangles.add(center, fill);
+		triangles.add(previous, fill);
+		triangles.add(next, fill);
+		previous = next;
+	}
+	DrawCircle(center, radius, color);
+	// The radius along axis shows how the circle has rotated
+	DrawSegment(center, center + radius * axis, color);
+}
+
+void PhysicsDebugDraw::DrawSegment(const b2Vec2 &p1, const b2Vec2 &p2, const b2Color &color) {
+	const Color4 c = toColor4(color, 1);
+	lines.add(p1, c);
+	lines.add(p2, c);
+}
+
+void PhysicsDebugDraw::DrawTransform(const b2Transform &xf) {
+	lines.add(xf.p, Color4(1, 0, 0, 1));
+	lines.add(xf.p + AXIS_SCALE * xf.q.GetXAxis(), Color4(1, 0, 0, 1));
+	lines.add(xf.p, Color4(0, 1, 0, 1));
+	lines.add(xf.p + AXIS_SCALE * xf.q.GetYAxis(), Color4(0, 1, 0, 1));
+}
+
+void PhysicsDebugDraw::flush(RenderDevice *rd, const shared_ptr<Shader> &shader) {
+	// Fills first, so the outlines stay visible on top of them
+	triangles.draw(rd, shader, PrimitiveType::TRIANGLES);
+	lines.draw(rd, shader, PrimitiveType::LINES);
+}
+
+void PhysicsDebugDraw::Primitives::add(const b2Vec2 &p, const Color4 &color) {
+	coords.append(Vector3(p.x, p.y, 0));
+	colors.append(color);
+}
+
+void PhysicsDebugDraw::Primitives::draw(RenderDevice *rd, const shared_ptr<Shader> &shader, PrimitiveType type) {
+	if (coords.size() == 0) {
+		return;
+	}
+
+	vdatabuf.refill(coords.size(), sizeof(Vector3) + sizeof(Color4));
+	vcoords = AttributeArray(coords, vdatabuf.buffer());
+	vcolors = AttributeArray(colors, vdatabuf.buffer());
+
+	Args args;
+	args.setAttributeArray("g3d_Vertex", vcoords);
+	args.setAttributeArray("color", vcolors);
+	args.setPrimitiveType(type);
+	args.setNumIndices(coords.size());
+	rd->apply(shader, args);
+
+	coords.fastClear();
+	colors.fastClear();
+}
@@ -0,0 +1,48 @@
+#ifndef PhysicsDebugDraw_h
+#define PhysicsDebugDraw_h
+
+#include <G3D/G3DAll.h>
+#include <Box2D/Box2D.h>
+#include "GrowableVertexBuffer.h"
+
+// Box2D's debug drawing (shapes, AABBs, joints, centers of mass) on the RenderDevice.
+// Every primitive b2World::DrawDebugData reports is collected into one list of lines
+// and one list of triangles, and flush() draws each list with a single call, so the
+// overlay costs two draw calls however many bodies there are.
+class PhysicsDebugDraw : public b2Draw {
+public:
+	PhysicsDebugDraw();
+
+	virtual void DrawPolygon(const b2Vec2 *vertices, int32 vertexCount, const b2Color &color);
+	virtual void DrawSolidPolygon(const b2Vec2 *vertices, int32 vertexCount, const b2Color &color);
+	virtual void DrawCircle(const b2Vec2 &center, float32 radius, const b2Color &color);
+	virtual void DrawSolidCircle(const b2Vec2 &center, float32 radius, const b2Vec2 &axis, const b2Color &color);
+	virtual void DrawSegment(const b2Vec2 &p1, const b2Vec2 &p2, const b2Color &color);
+	virtual void DrawTransform(const b2Transform &xf);
+
+	// Draws everything collected since the last flush with shader, then forgets it.
+	// Lines and triangles are in world space on the z=0 plane.
+	void flush(RenderDevice *rd, const shared_ptr<Shader> &shader);
+
+protected:
+	// Vertices and colors of one primitive type, and the GPU buffer they are copied
+	// into. The buffer only grows, so steady scenes reuse it every frame.
+	struct Primitives {
+		Primitives() : vdatabuf(VertexBuffer::WRITE_EVERY_FRAME) {}
+
+		Array<Vector3> coords;
+		Array<Color4> colors;
+
+		GrowableVertexBuffer vdatabuf;
+		AttributeArray vcoords;
+		AttributeArray vcolors;
+
+		void add(const b2Vec2 &p, const Color4 &color);
+		void draw(RenderDevice *rd, const shared_ptr<Shader> &shader, PrimitiveType type);
+	};
+
+	Primitives lines;
+	Primitives triangles;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include "PolylineBenchmark.h"
+#include "PolylineRenderer.h"
+#include <chrono>
+#include <cstdio>
+
+static const int STROKE_LENGTHS[] = { 1250, 2500, 5000, 10000, 20000 };
+
+// Every length builds at least this many points in total, so short strokes are timed over many builds
+static const int POINTS_PER_LENGTH = 400000;
+
+// A hand-drawn looking stroke with points 0.05 units apart
+static void makeStroke(int n, Array<Vector2> &points) {
+	points.resize(n);
+	for (int i = 0; i < n; i++) {
+		float x = i * 0.05f;
+		points[i] = Vector2(x, 0.3f * sinf(x * 1.7f) + 0.05f * sinf(x * 13.0f));
+	}
+}
+
+// Mean milliseconds per PolylineRenderer built from points
+static double timeBuilds(const Array<Vector2> &points, bool smooth, int repeats) {
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point start = Clock::now();
+	for (int r = 0; r < repeats; r++) {
+		PolylineRenderer stroke(points, smooth);
+	}
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeats;
+}
+
+int runPolylineBenchmark() {
+	Array<Vector2> points;
+	for (int i = 0; i < (int)(sizeof(STROKE_LENGTHS) / sizeof(STROKE_LENGTHS[0])); i++) {
+		const int n = STROKE_LENGTHS[i];
+		const int repeats = G3D::max(5, POINTS_PER_LENGTH / n);
+		makeStroke(n, points);
+
+		// One untimed build to warm up the allocator
+		PolylineRenderer warmup(points, true);
+		(void)warmup;
+
+		double smoothMs = timeBuilds(points, true, repeats);
+		double flatMs = timeBuilds(points, false, repeats);
+		printf("{\"points\":%d,\"repeats\":%d,"
+			"\"smooth\":{\"ms\":%.4f,\"nsPerPoint\":%.2f},"
+			"\"flat\":{\"ms\":%.4f,\"nsPerPoint\":%.2f}}\n",
+			n, repeats,
+			smoothMs, 1e6 * smoothMs / n,
+			flatMs, 1e6 * flatMs / n);
+		fflush(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,10 @@
+#ifndef PolylineBenchmark_h
+#define PolylineBenchmark_h
+
+// Times PolylineRenderer construction for strokes of increasing length, to check
+// that building a stroke stays linear in its number of points. Needs no window:
+//   CrayonPhysicsStudent --polyline-bench
+// prints one JSON object per stroke length and returns the exit code.
+int runPolylineBenchmark();
+
+#endif
@@ -1,117 +1,96 @@
 #include "PolylineRenderer.h"
 
-PolylineRenderer::PolylineRenderer(Array<Vector2> points, bool smooth, float thickness, float depth) {
-	Array<int> indices;
-	Array<Vector3> coords;
-	Array<Vector3> normals;
-	Array<Color3> colors;
-	int index = 0;
+// The stroke is a ribbon of width thickness around the points, extruded to depth
+// along z. Every point has an upper and a lower corner, each at the front (z = -depth/2)
+// and the back (z = depth/2). The front and back faces share their corner vertices
+// between segments. The side faces do too when smooth, since each corner then has a
+// single normal; flat sides need their own copy of the corners for every segment.
+// Unit normal of the stroke at every point, perpendicular to the chord through its
+// neighbors (or to the end segment at either end), in one pass over the points
+static void computeNormals(const Array<Vector2> &points, Array<Vector2> &normals) {
+	const int n = points.size();
+	normals.resize(n);
+	for (int i=0; i<n; i++) {
+		const Vector2 &prev = points[G3D::max(i-1, 0)];
+		const Vector2 &next = points[G3D::min(i+1, n-1)];
+		Vector2 diff = (next - prev).direction();
+		normals[i] = Vector2(-diff.y, diff.x);
+	}
+}
 
-	Color3 color(0.9, 0.5, 0.2);
+PolylineRenderer::PolylineRenderer(const Array<Vector2> &points, bool smooth, float thickness, float depth) {
+	const int n = points.size();
+	const float front = -depth/2;
+	const float back = depth/2;
+	const Vector3 znormal(0,0,1);
+
+	Array<Vector2> pointNormals;
+	computeNormals(points, pointNormals);
+
+	Array<Vector2> upper;
+	Array<Vector2> lower;
+	upper.resize(n);
+	lower.resize(n);
+	for (int i=0; i<n; i++) {
+		Vector2 offset = pointNormals[i] * thickness/2;
+		upper[i] = points[i] + offset;
+		lower[i] = points[i] - offset;
+	}
 
-	for (int i=0; i<points.size()-1; i++) {
-		Vector2 n1 = getNormal(i, points);
-		Vector2 n2 = getNormal(i+1, points);
+	const int vertexCount = smooth ? 8*n : 4*n + 8*G3D::max(n-1, 0);
+	coords.reserve(vertexCount);
+	normals.reserve(vertexCount);
+	indices.reserve(24*G3D::max(n-1, 0));
 
-		Vector2 p1 = points[i] + n1 * thickness/2;
-		Vector2 p2 = points[i+1] + n2 * thickness/2;
-		Vector2 p3 = points[i+1] - n2 * thickness/2;
-		Vector2 p4 = points[i] - n1 * thickness/2;
+	// Front and back faces: 4 vertices per point
+	for (int i=0; i<n; i++) {
+		coords.append(Vector3(upper[i], front), Vector3(lower[i], front), Vector3(upper[i], back), Vector3(lower[i], back));
+		normals.append(-znormal, -znormal, znormal, znormal);
+	}
 
-		Vector2 norm = (points[i+1]-points[i]).direction();
-		Vector3 normal1(-norm.y, norm.x, 0);
-		Vector3 normal2(-norm.y, norm.x, 0);
-		if (smooth) {
-			normal1 = Vector3(n1.x, n1.y, 0);
-			normal2 = Vector3(n2.x, n2.y, 0);
+	// Side faces: 4 vertices per point when smooth, 4 per end of each segment otherwise
+	const int sideBase = coords.size();
+	if (smooth) {
+		for (int i=0; i<n; i++) {
+			Vector3 normal(pointNormals[i], 0);
+			coords.append(Vector3(upper[i], front), Vector3(upper[i], back), Vector3(lower[i], front), Vector3(lower[i], back));
+			normals.append(normal, normal, -normal, -normal);
 		}
-		Vector3 znormal(0,0,1);
-
-		coords.append(Vector3(p1.x, p1.y, -depth/2));
-		coords.append(Vector3(p2.x, p2.y, -depth/2));
-		coords.append(Vector3(p3.x, p3.y, -depth/2));
-		coords.append(Vector3(p1.x, p1.y, -depth/2));
-		coords.append(Vector3(p3.x, p3.y, -depth/2));
-		coords.append(Vector3(p4.x, p4.y, -depth/2));
-
-		normals.append(-znormal,-znormal,-znormal,-znormal, -znormal,-znormal);
-		indices.append(index, index+1, index+2, index+3, index+4, index+5);
-		index += 6;
-
-		coords.append(Vector3(p1.x, p1.y, -depth/2));
-		coords.append(Vector3(p1.x, p1.y, depth/2));
-		coords.append(Vector3(p2.x, p2.y, depth/2));
-		coords.append(Vector3(p1.x, p1.y, -depth/2));
-		coords.append(Vector3(p2.x, p2.y, depth/2));
-		coords.append(Vector3(p2.x, p2.y, -depth/2));
-
-		normals.append(normal1,normal1,normal2,normal1, normal2, normal2);
-		indices.append(index, index+1, index+2, index+3, index+4, index+5);
-		index += 6;
-
-		coords.append(Vector3(p1.x, p1.y, depth/2));
-		coords.append(Vector3(p4.x, p4.y, depth/2));
-		coords.append(Vector3(p3.x, p3.y, depth/2));
-		coords.append(Vector3(p1.x, p1.y, depth/2));
-		coords.append(Vector3(p3.x, p3.y, depth/2));
-		coords.append(Vector3(p2.x, p2.y, depth/2));
-
-		normals.append(znormal,znormal,znormal,znormal, znormal, znormal);
-		indices.append(index, index+1, index+2, index+3, index+4, index+5);
-		index += 6;
-
-		coords.append(Vector3(p3.x, p3.y, -depth/2));
-		coords.append(Vector3(p3.x, p3.y, depth/2));
-		coords.append(Vector3(p4.x, p4.y, depth/2));
-		coords.append(Vector3(p3.x, p3.y, -depth/2));
-		coords.append(Vector3(p4.x, p4.y, depth/2));
-		coords.append(Vector3(p4.x, p4.y, -depth/2));
-		normals.append(-normal2,-normal2,-normal1,-normal2, -normal1, -normal1);
-		indices.append(index, index+1, index+2, index+3, index+4, index+5);
-		index += 6;
-
-
 	}
-
-	for (int i=0; i < coords.size(); i++) {
-		colors.append(color);
+	else {
+		for (int i=0; i<n-1; i++) {
+			Vector2 norm = (points[i+1]-points[i]).direction();
+			Vector3 normal(-norm.y, norm.x, 0);
+			for (int j=i; j<=i+1; j++) {
+				coords.append(Vector3(upper[j], front), Vector3(upper[j], back), Vector3(lower[j], front), Vector3(lower[j], back));
+				normals.append(normal, normal, -normal, -normal);
+			}
+		}
 	}
 
-	vdatabuf = VertexBuffer::create(
-		sizeof(Vector3) * coords.size()
-		+ sizeof(Vector3) * normals.size() + sizeof(Color3) * colors.size(),
-		VertexBuffer::WRITE_ONCE);
-
-	vindexbuf = VertexBuffer::create(sizeof(int)*indices.size(),
-		VertexBuffer::WRITE_ONCE/*,
-								VertexBuffer::INDEX*/);
-
-	vcoords = AttributeArray(coords, vdatabuf);
-	vnormals = AttributeArray(normals, vdatabuf);
-	vcolors = AttributeArray(colors, vdatabuf);
-	vindices = IndexStream(indices, vindexbuf);
+	for (int i=0; i<n-1; i++) {
+		// Corners of the segment's two ends on the front and back faces...
+		const int c1 = 4*i;
+		const int c2 = 4*(i+1);
+		// ...and on its sides
+		const int s1 = sideBase + (smooth ? 4*i : 8*i);
+		const int s2 = s1 + 4;
+
+		// front
+		indices.append(c1, c2, c2+1);
+		indices.append(c1, c2+1, c1+1);
+		// upper side
+		indices.append(s1, s1+1, s2+1);
+		indices.append(s1, s2+1, s2);
+		// back
+		indices.append(c1+2, c1+3, c2+3);
+		indices.append(c1+2, c2+3, c2+2);
+		// lower side
+		indices.append(s2+2, s2+3, s1+3);
+		indices.append(s2+2, s1+3, s1+2);
+	}
 }
 
-void PolylineRenderer::draw(RenderDevice *rd, shared_ptr<Shader> shader, Args &args) {
-	rd->pushState();
-	args.setAttributeArray("g3d_Vertex", vcoords);
-	args.setAttributeArray("g3d_Normal", vnormals);
-	args.setAttributeArray("color", vcolors);
-	args.setPrimitiveType(PrimitiveType::TRIANGLES);
-	args.setIndexStream(vindices);
-	rd->apply(shader, args);
-	rd->popState();
+void PolylineRenderer::appendTo(StaticGeometryBatch &batch) const {
+	batch.append(coords, normals, indices);
 }
-
-Vector2 PolylineRenderer::getNormal(int index, Array<Vector2> points) {
-	Vector2 diff;
-	if (index == 0) {
-		diff = (points[1] - points[0]).direction();
-
-	} else if (index == points.size() - 1) {
-		diff = (points[index] - points[index - 1]).direction();
-	} else {
-		diff = (points[index+1] - points[index-1]).direction();
-	}
-	return Vector2(-diff.y, diff.x);
-}
\ No newline at end of file
@@ -2,26 +2,22 @@
 #define PolylineRenderer_h
 
 #include <G3D/G3DAll.h>
+#include "StaticGeometryBatch.h"
 
+// Builds the triangles of a sketched stroke extruded along z. The static ones
+// are all drawn together from a StaticGeometryBatch.
 class PolylineRenderer /* : public  ReferenceCountedObject */ {
 public:
 	PolylineRenderer() {}
-	PolylineRenderer(Array<Vector2> points, bool smooth=false, float thickness=0.04, float depth=0.5);
-	void draw(RenderDevice *rd, shared_ptr<Shader> shader, Args &args);
+	PolylineRenderer(const Array<Vector2> &points, bool smooth=false, float thickness=0.04, float depth=0.5);
+	// Copies the stroke's geometry to the end of batch
+	void appendTo(StaticGeometryBatch &batch) const;
 protected:
-	Vector2 getNormal(int index, Array<Vector2> points);
+	Array<Vector3> coords;
 
-	shared_ptr<VertexBuffer> vdatabuf;
+	Array<Vector3> normals;
 
-	shared_ptr<VertexBuffer> vindexbuf;
-
-	AttributeArray vnormals;
-
-	AttributeArray vcoords;
-
-	AttributeArray vcolors;
-
-	IndexStream vindices;
+	Array<int> indices;
 };
 
 #endif
\ No newline at end of file
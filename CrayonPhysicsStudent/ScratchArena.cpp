@@ -0,0 +1,41 @@
+#include "ScratchArena.h"
+
+// Every allocation is aligned to this, which covers b2Vec2 and friends
+static const size_t ALIGNMENT = 16;
+
+static const size_t MIN_CAPACITY = 4096;
+
+ScratchArena::ScratchArena() : block(NULL), capacity(0), used(0), peakUsed(0), numGrowths(0) {
+}
+
+ScratchArena::~ScratchArena() {
+	reset();
+	System::free(block);
+}
+
+void *ScratchArena::allocBytes(size_t bytes) {
+	size_t offset = (used + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	if (offset + bytes > capacity) {
+		// Earlier allocations may still be in use, so the old block lives until reset()
+		if (used > 0) {
+			retired.append(block);
+		} else {
+			System::free(block);
+		}
+		capacity = G3D::max(G3D::max(MIN_CAPACITY, 2 * capacity), bytes);
+		block = static_cast<uint8*>(System::malloc(capacity));
+		numGrowths++;
+		offset = 0;
+	}
+	used = offset + bytes;
+	peakUsed = G3D::max(peakUsed, used);
+	return block + offset;
+}
+
+void ScratchArena::reset() {
+	for (int i = 0; i < retired.size(); i++) {
+		System::free(retired[i]);
+	}
+	retired.fastClear();
+	used = 0;
+}
@@ -0,0 +1,45 @@
+#ifndef ScratchArena_h
+#define ScratchArena_h
+
+#include <G3D/G3DAll.h>
+
+// Bump allocator for short-lived arrays, such as the vertices handed to
+// b2ChainShape::CreateChain. Everything allocated is released at once by
+// reset(). Once the arena has grown to the largest size a caller needs,
+// alloc() and reset() do no heap allocation at all.
+class ScratchArena {
+public:
+	ScratchArena();
+	~ScratchArena();
+
+	// Uninitialized storage for count values of T, valid until the next reset()
+	template<class T>
+	T *alloc(int count) {
+		return static_cast<T*>(allocBytes(sizeof(T) * count));
+	}
+
+	void reset();
+
+	// Bytes currently held from the heap
+	size_t reserved() const { return capacity; }
+
+	// Most bytes ever in use between two resets
+	size_t peak() const { return peakUsed; }
+
+	// Number of times the arena had to go back to the heap
+	int growths() const { return numGrowths; }
+
+protected:
+	void *allocBytes(size_t bytes);
+
+	uint8 *block;
+	size_t capacity;
+	size_t used;
+	size_t peakUsed;
+	int numGrowths;
+
+	// Blocks outgrown while allocations from them were still live; freed by reset()
+	Array<uint8*> retired;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include "ScreenProjection.h"
+
+Matrix4 screenToWorldMatrix(const Camera &camera, const Rect2D &viewport) {
+	Matrix4 projection;
+	camera.getProjectUnitMatrix(viewport, projection);
+	return (projection * Matrix4(camera.frame().inverse())).inverse();
+}
+
+bool unprojectToGround(const Matrix4 &screenToWorld, const Rect2D &viewport, const Array<Vector2> &pixels,
+	Array<Vector2> &result, Vector2 &lower, Vector2 &upper) {
+	const int n = pixels.size();
+	result.resize(n);
+	if (n == 0) {
+		lower = upper = Vector2(0, 0);
+		return true;
+	}
+
+	// The points on the near (ndc z = -1) and far (z = 1) planes under a pixel are
+	// screenToWorld * (x, y, -+1, 1), so with M's columns c0..c3 they are
+	// c0*x + c1*y + (c3 -+ c2). Pull those terms out of the matrix once.
+	const Matrix4 &M = screenToWorld;
+	float cx[4], cy[4], nearBase[4], farBase[4];
+	for (int r = 0; r < 4; r++) {
+		cx[r] = M[r][0];
+		cy[r] = M[r][1];
+		nearBase[r] = M[r][3] - M[r][2];
+		farBase[r] = M[r][3] + M[r][2];
+	}
+
+	// Pixels to ndc, flipping y so that it points up
+	const float sx = 2.0f / viewport.width();
+	const float sy = -2.0f / viewport.height();
+	const float ox = -1.0f - viewport.x0() * sx;
+	const float oy = 1.0f - viewport.y0() * sy;
+
+	float minX = finf(), minY = finf();
+	float maxX = -finf(), maxY = -finf();
+	int misses = 0;
+
+	for (int i = 0; i < n; i++) {
+		const float x = pixels[i].x * sx + ox;
+		const float y = pixels[i].y * sy + oy;
+
+		const float nw = cx[3] * x + cy[3] * y + nearBase[3];
+		const float fw = cx[3] * x + cy[3] * y + farBase[3];
+		const float nx = (cx[0] * x + cy[0] * y + nearBase[0]) / nw;
+		const float ny = (cx[1] * x + cy[1] * y + nearBase[1]) / nw;
+		const float nz = (cx[2] * x + cy[2] * y + nearBase[2]) / nw;
+		const float fx = (cx[0] * x + cy[0] * y + farBase[0]) / fw;
+		const float fy = (cx[1] * x + cy[1] * y + farBase[1]) / fw;
+		const float fz = (cx[2] * x + cy[2] * y + farBase[2]) / fw;
+
+		// The ray from the near point towards the far point reaches z = 0 at t, if t >= 0
+		const float dz = fz - nz;
+		const float t = (dz != 0) ? -nz / dz : -1.0f;
+		const bool hit = t >= 0;
+		const float px = hit ? nx + (fx - nx) * t : 0.0f;
+		const float py = hit ? ny + (fy - ny) * t : 0.0f;
+		misses += hit ? 0 : 1;
+
+		result[i] = Vector2(px, py);
+		minX = G3D::min(minX, px);
+		minY = G3D::min(minY, py);
+		maxX = G3D::max(maxX, px);
+		maxY = G3D::max(maxY, py);
+	}
+
+	lower = Vector2(minX, minY);
+	upper = Vector2(maxX, maxY);
+	return misses == 0;
+}
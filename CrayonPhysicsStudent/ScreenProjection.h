@@ -0,0 +1,16 @@
+#ifndef ScreenProjection_h
+#define ScreenProjection_h
+
+#include <G3D/G3DAll.h>
+
+// Maps homogeneous normalized device coordinates back to world space for camera
+// drawing into viewport (the inverse of its view-projection matrix)
+Matrix4 screenToWorldMatrix(const Camera &camera, const Rect2D &viewport);
+
+// Intersects the view ray through each pixel (y down, as from UserInput) with the
+// z=0 plane, writing the points to result and their bounding rectangle to lower..upper.
+// Pixels whose ray never reaches the plane map to the origin, and make it return false.
+bool unprojectToGround(const Matrix4 &screenToWorld, const Rect2D &viewport, const Array<Vector2> &pixels,
+	Array<Vector2> &result, Vector2 &lower, Vector2 &upper);
+
+#endif
@@ -0,0 +1,367 @@
+#include "Simulation.h"
+
+// Each b2Body's user data says which of the Simulation's tables the body is in and
+// its handle there, so bodies found by broadphase queries map back to their rows
+enum BodyKind {
+	CIRCLE_BODY = 0,
+	BOX_BODY = 1,
+	POLYLINE_BODY = 2
+};
+
+static void *bodyTag(BodyKind kind, int handle) {
+	return (void*)(intptr_t)((handle << 2) | kind);
+}
+
+static BodyKind tagKind(const void *tag) {
+	return (BodyKind)((intptr_t)tag & 3);
+}
+
+static int tagHandle(const void *tag) {
+	return (int)((intptr_t)tag >> 2);
+}
+
+// Collects the movable bodies whose fixtures overlap a query region
+class BodyQuery : public b2QueryCallback {
+public:
+	BodyQuery(Array<b2Body*> &bodies) : bodies(bodies) {}
+
+	virtual bool ReportFixture(b2Fixture *fixture) {
+		b2Body *body = fixture->GetBody();
+		if (body->GetType() != b2_staticBody) {
+			bodies.append(body);
+		}
+		return true;
+	}
+
+protected:
+	Array<b2Body*> &bodies;
+};
+
+static void snapshotRow(const BodyTable &table, int row, BodySnapshot &s) {
+	s.id = table.ids[row];
+	s.previousPosition = table.previousPositions[row];
+	s.previousAngle = table.previousAngles[row];
+	s.position = table.positions[row];
+	s.angle = table.angles[row];
+	s.size = table.sizes[row];
+}
+
+float WorldSnapshot::alpha(RealTime now) const {
+	double pending = stepAccumulator + G3D::max(now - time, 0.0);
+	return clamp((float)(pending / physicsTimeStep), 0.0f, 1.0f);
+}
+
+Simulation::Simulation() : physicsTimeStep(1/120.0f), maxStepsPerFrame(8), killOutside(false),
+	stepAccumulator(0), nextBodyId(0), sleepingGeneration(1), cullToView(false) {
+    //create Box2D world, setting gravity vector
+	world = new b2World(b2Vec2(0, -9.8));
+
+	// Far enough outside the paper that nothing in it can be seen again
+	killRegion.lowerBound.Set(-200, -100);
+	killRegion.upperBound.Set(200, 1000);
+}
+
+Simulation::~Simulation() {
+	delete world;
+}
+
+void Simulation::apply(const SimulationCommand &command) {
+	switch (command.type) {
+	case SimulationCommand::ADD_CIRCLE:
+		addCircle(command.position, command.width);
+		break;
+	case SimulationCommand::ADD_BOX:
+		addBox(command.position, command.width, command.height);
+		break;
+	case SimulationCommand::ADD_POLYLINE:
+		addPolyline(command.verts);
+		break;
+	case SimulationCommand::ADD_BODIES:
+		addBodies(command.spawns);
+		break;
+	case SimulationCommand::RESET:
+		resetWorld();
+		break;
+	case SimulationCommand::SET_VIEW_REGION:
+		setViewRegion(command.position, command.width, command.height);
+		break;
+	case SimulationCommand::SET_KILL_VOLUME:
+		killOutside = command.width > 0;
+		break;
+	}
+}
+
+void Simulation::addCircle(Vector2 position, float radius) {
+    b2BodyDef bodyDef;
+    bodyDef.type = b2_dynamicBody;
+    bodyDef.position.Set(position.x, position.y);
+    b2Body *body = world->CreateBody(&bodyDef);
+
+    b2CircleShape circle;
+    circle.m_radius = radius;
+    b2FixtureDef fixtureDef;
+    fixtureDef.shape = &circle;
+    fixtureDef.density = .2f;
+    fixtureDef.friction = .3f;
+    fixtureDef.restitution = 0.3f;
+    body->CreateFixture(&fixtureDef);
+
+    int handle = circles.add(body, nextBodyId++, Vector2(radius, radius));
+    body->SetUserData(bodyTag(CIRCLE_BODY, handle));
+}
+
+void Simulation::addBox(Vector2 position, float width, float height){
+
+    b2BodyDef bodyDef;
+    bodyDef.type = b2_dynamicBody;
+    bodyDef.position.Set(position.x, position.y);
+    b2Body *body = world->CreateBody(&bodyDef);
+
+    b2PolygonShape boxShape;
+    boxShape.SetAsBox(width/2, height/2);
+
+    b2FixtureDef fixtureDef;
+    fixtureDef.shape = &boxShape;
+    fixtureDef.density = .2f;
+    fixtureDef.friction = .3f;
+    fixtureDef.restitution = 0.3f;
+    body->CreateFixture(&fixtureDef);
+
+    int handle = boxes.add(body, nextBodyId++, Vector2(width, height));
+    body->SetUserData(bodyTag(BOX_BODY, handle));
+}
+
+void Simulation::addPolyline(const Array<Vector2> &verts){
+    int size = verts.size();
+    if (size >=2) {
+        b2BodyDef bodyDef;
+        bodyDef.type = b2_staticBody;
+
+        b2Body *body = world->CreateBody(&bodyDef);
+        b2Vec2 *vs = scratch.alloc<b2Vec2>(size);
+        for(int i=0;i<size;i++){
+            vs[i].Set(verts[i].x, verts[i].y);
+        }
+        b2ChainShape chainShape;
+        chainShape.CreateChain(vs, size);
+
+        b2FixtureDef fixtureDef;
+        fixtureDef.shape = &chainShape;
+        fixtureDef.density = .2f;
+        fixtureDef.friction = .3f;
+        fixtureDef.restitution = 1.0f;
+        body->CreateFixture(&fixtureDef);
+
+        // Polylines have no size to draw them at; their geometry stays with App
+        int handle = polylines.add(body, nextBodyId++, Vector2(0, 0));
+        body->SetUserData(bodyTag(POLYLINE_BODY, handle));
+
+        // CreateChain keeps its own copy of the vertices
+        scratch.reset();
+    }
+}
+
+// Creates a batch of bodies from one command, growing the tables once for the whole batch
+void Simulation::addBodies(const Array<BodySpawn> &spawns) {
+    if (spawns.size() == 0) {
+        return;
+    }
+
+    // Grow the tables once for the whole batch
+    int newCircles = 0;
+    for (int i=0; i<spawns.size(); i++) {
+        newCircles += (spawns[i].shape == BodySpawn::CIRCLE) ? 1 : 0;
+    }
+    circles.reserve(circles.size() + newCircles);
+    boxes.reserve(boxes.size() + spawns.size() - newCircles);
+
+    for (int i=0; i<spawns.size(); i++) {
+        const BodySpawn &spawn = spawns[i];
+        if (spawn.shape == BodySpawn::CIRCLE) {
+            addCircle(spawn.position, spawn.width);
+        } else {
+            addBox(spawn.position, spawn.width, spawn.height);
+        }
+    }
+}
+
+void Simulation::resetWorld() {
+    // Deleting the world hands its block allocator's chunks back wholesale, without
+    // the per-body contact and broadphase teardown that DestroyBody would do
+    delete world;
+    world = new b2World(b2Vec2(0, -9.8));
+
+    // Keep the tables' storage for the next scene
+    circles.clear();
+    boxes.clear();
+    polylines.clear();
+    scratch.reset();
+    stepAccumulator = 0;
+    nextBodyId = 0;
+    sleepingGeneration++;
+}
+
+int Simulation::advance(double elapsed) {
+	stepAccumulator += G3D::max(elapsed, 0.0);
+	int steps = 0;
+	while (stepAccumulator >= physicsTimeStep && steps < maxStepsPerFrame) {
+		stepWorld();
+		stepAccumulator -= physicsTimeStep;
+		steps++;
+	}
+	// Too far behind to catch up: drop the backlog instead of spiralling
+	if (stepAccumulator >= physicsTimeStep) {
+		stepAccumulator = fmod(stepAccumulator, (double)physicsTimeStep);
+	}
+	if (steps > 0 && killOutside) {
+		destroyBodiesOutside(killRegion);
+	}
+	return steps;
+}
+
+void Simulation::setViewRegion(Vector2 lower, float width, float height) {
+	const bool cull = width > 0 && height > 0;
+	b2AABB region;
+	region.lowerBound.Set(lower.x, lower.y);
+	region.upperBound.Set(lower.x + width, lower.y + height);
+	// The app sends the region every frame, but the visible sleepers only change when it moves
+	if (cull != cullToView || (cull && !(region.lowerBound == viewRegion.lowerBound && region.upperBound == viewRegion.upperBound))) {
+		sleepingGeneration++;
+	}
+	cullToView = cull;
+	viewRegion = region;
+}
+
+static bool contains(const b2AABB &region, const b2Vec2 &p) {
+	return p.x >= region.lowerBound.x && p.y >= region.lowerBound.y &&
+		p.x <= region.upperBound.x && p.y <= region.upperBound.y;
+}
+
+void Simulation::destroyBodiesOutside(const b2AABB &region) {
+	destroyBodiesOutside(circles, region);
+	destroyBodiesOutside(boxes, region);
+}
+
+void Simulation::destroyBodiesOutside(BodyTable &table, const b2AABB &region) {
+	// Sleeping bodies don't move, so only the awake ones can have left. Backwards, so
+	// the row swapped into a removed one has already been checked.
+	for (int i=table.awakeSize()-1; i>=0; i--) {
+		const Vector2 &p = table.positions[i];
+		if (!contains(region, b2Vec2(p.x, p.y))) {
+			world->DestroyBody(table.bodies[i]);
+			table.removeRow(i);
+		}
+	}
+}
+
+double Simulation::timeUntilNextStep() const {
+	return G3D::max(physicsTimeStep - stepAccumulator, 0.0);
+}
+
+void Simulation::stepWorld() {
+	circles.savePrevious();
+	boxes.savePrevious();
+	world->Step(physicsTimeStep, 6, 2);
+	// Woken rows join the awake ones first, so the sweep reads them too
+	int changed = wakeTouchedBodies();
+	changed += circles.sweep() + boxes.sweep();
+	if (changed > 0) {
+		sleepingGeneration++;
+	}
+}
+
+// Box2D only wakes a sleeping body through a contact with an awake one, possibly
+// through a chain of them that the island solver woke in the same step. So following
+// the contacts out from the bodies that were awake before the step finds every body
+// it woke, without looking at the sleeping ones. Returns how many there were.
+int Simulation::wakeTouchedBodies() {
+	wakeQueue.fastClear();
+	for (int i=0; i<circles.awakeSize(); i++) {
+		wakeQueue.append(circles.bodies[i]);
+	}
+	for (int i=0; i<boxes.awakeSize(); i++) {
+		wakeQueue.append(boxes.bodies[i]);
+	}
+
+	// Bodies woken here are appended, so their contacts are followed too
+	int woken = 0;
+	for (int i=0; i<wakeQueue.size(); i++) {
+		const b2Body *body = wakeQueue[i];
+		for (const b2ContactEdge *edge = body->GetContactList(); edge; edge = edge->next) {
+			b2Body *other = edge->other;
+			if (other->GetType() != b2_dynamicBody || !other->IsAwake()) {
+				continue;
+			}
+			const void *tag = other->GetUserData();
+			BodyTable &table = (tagKind(tag) == CIRCLE_BODY) ? circles : boxes;
+			const int row = table.row(tagHandle(tag));
+			if (!table.isAwake(row)) {
+				table.wake(row);
+				wakeQueue.append(other);
+				woken++;
+			}
+		}
+	}
+	return woken;
+}
+
+void Simulation::drawDebugData(b2Draw *draw) {
+	// Registered on every call, since resetWorld replaces the world
+	world->SetDebugDraw(draw);
+	world->DrawDebugData();
+	world->SetDebugDraw(NULL);
+}
+
+// Copies the awake rows of table, or the ones whose fixture overlaps the view region
+void Simulation::snapshotAwake(const BodyTable &table, Array<BodySnapshot> &out) const {
+	out.fastClear();
+	for (int i=0; i<table.awakeSize(); i++) {
+		if (!cullToView || b2TestOverlap(table.bodies[i]->GetFixtureList()->GetAABB(0), viewRegion)) {
+			snapshotRow(table, i, out.next());
+		}
+	}
+}
+
+void Simulation::snapshot(WorldSnapshot &out, RealTime now) {
+	snapshotAwake(circles, out.circles);
+	snapshotAwake(boxes, out.boxes);
+
+	// The sleeping bodies in out are still right if nothing fell asleep, woke up or
+	// came into view since they were copied, so per snapshot this costs O(awake bodies)
+	if (out.sleepingGeneration != sleepingGeneration) {
+		out.sleepingCircles.fastClear();
+		out.sleepingBoxes.fastClear();
+		if (cullToView) {
+			visibleBodies.fastClear();
+			BodyQuery query(visibleBodies);
+			world->QueryAABB(&query, viewRegion);
+
+			for (int i=0; i<visibleBodies.size(); i++) {
+				const void *tag = visibleBodies[i]->GetUserData();
+				int handle = tagHandle(tag);
+				if (tagKind(tag) == CIRCLE_BODY && !circles.isAwake(circles.row(handle))) {
+					snapshotRow(circles, circles.row(handle), out.sleepingCircles.next());
+				}
+				else if (tagKind(tag) == BOX_BODY && !boxes.isAwake(boxes.row(handle))) {
+					snapshotRow(boxes, boxes.row(handle), out.sleepingBoxes.next());
+				}
+			}
+		}
+		else {
+			for (int i=circles.awakeSize(); i<circles.size(); i++) {
+				snapshotRow(circles, i, out.sleepingCircles.next());
+			}
+			for (int i=boxes.awakeSize(); i<boxes.size(); i++) {
+				snapshotRow(boxes, i, out.sleepingBoxes.next());
+			}
+		}
+		out.sleepingGeneration = sleepingGeneration;
+	}
+
+	out.stepAccumulator = stepAccumulator;
+	out.physicsTimeStep = physicsTimeStep;
+	out.time = now;
+	out.scratchReserved = scratch.reserved();
+	out.scratchPeak = scratch.peak();
+	out.scratchGrowths = scratch.growths();
+}
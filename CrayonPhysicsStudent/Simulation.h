@@ -0,0 +1,163 @@
+#ifndef Simulation_h
+#define Simulation_h
+
+#include <G3D/G3DAll.h>
+#include <Box2D/Box2D.h>
+#include "ScratchArena.h"
+#include "BodyTable.h"
+
+
+// One body as of the latest physics step, copied out of its b2Body for rendering
+struct BodySnapshot {
+	// BodyTable::ids entry, for renderer state that follows a body across frames
+	int id;
+	Vector2 previousPosition;
+	float previousAngle;
+	Vector2 position;
+	float angle;
+	// (radius, radius) for circles, (width, height) for boxes
+	Vector2 size;
+};
+
+// Everything the renderer reads from the physics world. Filled by
+// Simulation::snapshot, so drawing never touches a b2Body directly.
+struct WorldSnapshot {
+	WorldSnapshot() : sleepingGeneration(0), stepAccumulator(0), physicsTimeStep(1), time(0),
+		scratchReserved(0), scratchPeak(0), scratchGrowths(0) {}
+
+	// Awake bodies, copied on every snapshot
+	Array<BodySnapshot> circles;
+	Array<BodySnapshot> boxes;
+
+	// Bodies Box2D has put to sleep, which don't move until woken. They are only
+	// copied again when sleepingGeneration changes: when a body falls asleep or wakes
+	// up, and when the view region changes.
+	Array<BodySnapshot> sleepingCircles;
+	Array<BodySnapshot> sleepingBoxes;
+	int sleepingGeneration;
+
+	// Time carried towards the next step when the snapshot was taken, and when that was
+	double stepAccumulator;
+	float physicsTimeStep;
+	RealTime time;
+
+	// Simulation's scratch arena, to check memory stays flat over long sessions
+	size_t scratchReserved;
+	size_t scratchPeak;
+	int scratchGrowths;
+
+	// Fraction of a step to interpolate bodies by when drawing at time now
+	float alpha(RealTime now) const;
+};
+
+// One body of an ADD_BODIES command, with the same fixture as ADD_CIRCLE or ADD_BOX
+struct BodySpawn {
+	enum Shape {
+		CIRCLE,
+		BOX
+	};
+	Shape shape;
+	Vector2 position;
+	// radius for circles
+	float width;
+	float height;
+};
+
+// A change to the world requested by the UI. Commands are applied between
+// physics steps, either directly or by the SimulationThread that owns the world.
+struct SimulationCommand {
+	enum Type {
+		ADD_CIRCLE,
+		ADD_BOX,
+		ADD_POLYLINE,
+		ADD_BODIES,
+		RESET,
+		SET_VIEW_REGION,
+		SET_KILL_VOLUME
+	};
+	Type type;
+	// Lower corner of the region for SET_VIEW_REGION
+	Vector2 position;
+	// radius for ADD_CIRCLE; a SET_VIEW_REGION with no area turns culling off, and a
+	// SET_KILL_VOLUME with width > 0 turns the kill volume on
+	float width;
+	float height;
+	// ADD_POLYLINE only
+	Array<Vector2> verts;
+	// ADD_BODIES only
+	Array<BodySpawn> spawns;
+};
+
+// Owns the Box2D world and the bodies created from sketches, and advances it
+// in fixed steps.
+class Simulation {
+public:
+	Simulation();
+	~Simulation();
+
+	void apply(const SimulationCommand &command);
+
+	// Runs as many fixed steps as elapsed seconds call for (at most maxStepsPerFrame)
+	// and returns how many were taken
+	int advance(double elapsed);
+
+	// Seconds until enough time will have accumulated for the next step
+	double timeUntilNextStep() const;
+
+	// Copies the state of the bodies in the view region into out, reusing its storage
+	void snapshot(WorldSnapshot &out, RealTime now);
+
+	// Reports the world to draw through b2World::DrawDebugData. Reads the bodies,
+	// so it must be called from whichever thread owns the simulation.
+	void drawDebugData(b2Draw *draw);
+
+	// Seconds of simulated time per b2World::Step
+	float physicsTimeStep;
+	int maxStepsPerFrame;
+
+	// When killOutside is set, dynamic bodies whose centers leave killRegion are destroyed.
+	// Off by default; the app toggles it with K.
+	bool killOutside;
+	b2AABB killRegion;
+
+protected:
+    void addCircle(Vector2 position, float radius);
+    void addBox(Vector2 position, float width, float height);
+    void addPolyline(const Array<Vector2> &verts);
+    void addBodies(const Array<BodySpawn> &spawns);
+    void resetWorld();
+    void stepWorld();
+    int wakeTouchedBodies();
+    void snapshotAwake(const BodyTable &table, Array<BodySnapshot> &out) const;
+    void setViewRegion(Vector2 lower, float width, float height);
+    void destroyBodiesOutside(const b2AABB &region);
+    void destroyBodiesOutside(BodyTable &table, const b2AABB &region);
+
+    b2World *world;
+
+    // Simulated time not yet consumed by a step
+    double stepAccumulator;
+
+    int nextBodyId;
+
+    // Bumped whenever the sleeping bodies a snapshot would hold change
+    int sleepingGeneration;
+    // Bodies whose contacts wakeTouchedBodies still has to follow
+    Array<b2Body*> wakeQueue;
+
+    // Each body's user data tags it with its kind and its handle in the matching table
+    BodyTable circles;
+    BodyTable boxes;
+    BodyTable polylines;
+
+    // Only bodies whose fixtures overlap this region are snapshotted, found through
+    // the broadphase with b2World::QueryAABB. Off until the first SET_VIEW_REGION.
+    bool cullToView;
+    b2AABB viewRegion;
+    Array<b2Body*> visibleBodies;
+
+    // Temporary storage for building shapes, emptied after each body is created
+    ScratchArena scratch;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#include "SimulationThread.h"
+#include <chrono>
+
+SimulationThread::SimulationThread(const shared_ptr<Simulation> &simulation) : simulation(simulation), running(false) {
+}
+
+SimulationThread::~SimulationThread() {
+	stop();
+}
+
+void SimulationThread::start() {
+	if (running.load()) {
+		return;
+	}
+	// Publish the current state so the renderer has something to draw before the first step
+	publish(System::time());
+	running.store(true);
+	thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop() {
+	if (!running.load()) {
+		return;
+	}
+	running.store(false);
+	thread.join();
+}
+
+void SimulationThread::post(const SimulationCommand &command) {
+	// The queue only fills up if the worker is stalled; wait for it rather than drop input
+	while (!commands.push(command)) {
+		std::this_thread::yield();
+	}
+}
+
+const WorldSnapshot &SimulationThread::latestSnapshot() {
+	return snapshots.readBuffer();
+}
+
+void SimulationThread::publish(RealTime now) {
+	simulation->snapshot(snapshots.writeBuffer(), now);
+	snapshots.publish();
+}
+
+void SimulationThread::run() {
+	SimulationCommand command;
+	RealTime last = System::time();
+
+	while (running.load()) {
+		bool changed = false;
+		while (commands.pop(command)) {
+			simulation->apply(command);
+			changed = true;
+		}
+
+		RealTime now = System::time();
+		int steps = simulation->advance(now - last);
+		last = now;
+		if (steps > 0 || changed) {
+			publish(now);
+		}
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(simulation->timeUntilNextStep()));
+	}
+
+	while (commands.pop(command)) {
+		simulation->apply(command);
+	}
+}
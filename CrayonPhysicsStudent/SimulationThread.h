@@ -0,0 +1,110 @@
+#ifndef SimulationThread_h
+#define SimulationThread_h
+
+#include <G3D/G3DAll.h>
+#include <atomic>
+#include <thread>
+#include "Simulation.h"
+
+// Bounded single-producer/single-consumer queue. push() is only called from one
+// thread and pop() from one other thread; neither ever blocks or takes a lock.
+template<class T, unsigned N>
+class CommandQueue {
+public:
+	CommandQueue() : head(0), tail(0) {}
+
+	// Returns false if the queue is full
+	bool push(const T &item) {
+		unsigned t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == N) {
+			return false;
+		}
+		items[t % N] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Returns false if the queue is empty
+	bool pop(T &item) {
+		unsigned h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		item = items[h % N];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	// Indices wrap around at 2^32, so N must divide it evenly
+	static_assert((N & (N - 1)) == 0, "CommandQueue size must be a power of two");
+
+	T items[N];
+	std::atomic<unsigned> head;
+	std::atomic<unsigned> tail;
+};
+
+// Hands whole values from one writer thread to one reader thread without locks.
+// The writer fills writeBuffer() and calls publish(); the reader's readBuffer()
+// stays untouched until the reader asks again, at which point it switches to the
+// newest published value.
+template<class T>
+class TripleBuffer {
+public:
+	TripleBuffer() : back(0), front(2), middle(1) {}
+
+	T &writeBuffer() { return buffers[back]; }
+
+	void publish() {
+		back = middle.exchange(back | FRESH) & INDEX;
+	}
+
+	const T &readBuffer() {
+		if (middle.load(std::memory_order_relaxed) & FRESH) {
+			front = middle.exchange(front) & INDEX;
+		}
+		return buffers[front];
+	}
+
+private:
+	enum { INDEX = 3, FRESH = 4 };
+
+	T buffers[3];
+	int back;
+	int front;
+	// Index of the buffer between back and front, plus FRESH if the reader has not taken it yet
+	std::atomic<int> middle;
+};
+
+// Steps a Simulation on its own thread. Between start() and stop() the worker
+// owns the simulation: the UI thread only post()s commands and reads the
+// latest snapshot of body state, so rendering never waits on b2World::Step.
+class SimulationThread {
+public:
+	SimulationThread(const shared_ptr<Simulation> &simulation);
+	~SimulationThread();
+
+	void start();
+
+	// Applies any commands still queued, then hands the simulation back to the calling thread
+	void stop();
+
+	void post(const SimulationCommand &command);
+
+	// Body state after the most recent step; valid until the next call
+	const WorldSnapshot &latestSnapshot();
+
+protected:
+	void run();
+	void publish(RealTime now);
+
+	shared_ptr<Simulation> simulation;
+
+	std::thread thread;
+	std::atomic<bool> running;
+
+	CommandQueue<SimulationCommand, 256> commands;
+	TripleBuffer<WorldSnapshot> snapshots;
+};
+
+#endif
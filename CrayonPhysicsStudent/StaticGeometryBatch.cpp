@@ -0,0 +1,113 @@
+#include "StaticGeometryBatch.h"
+
+static const int MIN_VERTEX_CAPACITY = 1024;
+static const int MIN_INDEX_CAPACITY = 2048;
+
+// Vertices addressable by a 16-bit index
+static const int SHORT_INDEX_LIMIT = 65536;
+
+// Doubling alone never takes the vertex buffer past SHORT_INDEX_LIMIT, so the
+// batch stays on 16-bit indices until its vertices really don't fit
+StaticGeometryBatch::StaticGeometryBatch() : shortIndices(true),
+	vdatabuf(VertexBuffer::WRITE_ONCE, MIN_VERTEX_CAPACITY, SHORT_INDEX_LIMIT),
+	vindexbuf(VertexBuffer::WRITE_ONCE, MIN_INDEX_CAPACITY) {
+}
+
+void StaticGeometryBatch::append(const Array<Vector3> &newCoords, const Array<Vector3> &newNormals, const Array<int> &newIndices) {
+	if (newIndices.size() == 0) {
+		return;
+	}
+
+	const int firstVertex = coords.size();
+	const int firstIndex = indices.size();
+	coords.append(newCoords);
+	normals.append(newNormals);
+	for (int i = 0; i < newIndices.size(); i++) {
+		indices.append(firstVertex + newIndices[i]);
+	}
+
+	if (firstIndex == 0) {
+		boundsMin = boundsMax = newCoords[0].xy();
+	}
+	for (int i = 0; i < newCoords.size(); i++) {
+		boundsMin = boundsMin.min(newCoords[i].xy());
+		boundsMax = boundsMax.max(newCoords[i].xy());
+	}
+
+	// Each buffer is only reallocated when it overflows itself, except that the
+	// index buffer has to be rebuilt once when the vertices outgrow 16-bit indices
+	if (coords.size() > vdatabuf.capacity()) {
+		growVertices();
+	} else {
+		for (int i = firstVertex; i < coords.size(); i++) {
+			vcoords.set(i, coords[i]);
+			vnormals.set(i, normals[i]);
+		}
+	}
+
+	if (indices.size() > vindexbuf.capacity() || shortIndices != (vdatabuf.capacity() <= SHORT_INDEX_LIMIT)) {
+		growIndices();
+		return;
+	}
+	for (int i = firstIndex; i < indices.size(); i++) {
+		if (shortIndices) {
+			vindices.set(i, (uint16)indices[i]);
+		} else {
+			vindices.set(i, indices[i]);
+		}
+	}
+}
+
+void StaticGeometryBatch::growVertices() {
+	vdatabuf.grow(coords.size(), sizeof(Vector3) + sizeof(Vector3));
+
+	Array<Vector3> paddedCoords(coords);
+	Array<Vector3> paddedNormals(normals);
+	paddedCoords.resize(vdatabuf.capacity());
+	paddedNormals.resize(vdatabuf.capacity());
+	vcoords = AttributeArray(paddedCoords, vdatabuf.buffer());
+	vnormals = AttributeArray(paddedNormals, vdatabuf.buffer());
+}
+
+void StaticGeometryBatch::growIndices() {
+	shortIndices = vdatabuf.capacity() <= SHORT_INDEX_LIMIT;
+	vindexbuf.grow(indices.size(), shortIndices ? sizeof(uint16) : sizeof(int));
+
+	// Only the first indices.size() are drawn, so the tail is just room to append into
+	Array<int> paddedIndices(indices);
+	paddedIndices.resize(vindexbuf.capacity());
+	uploadIndices(paddedIndices);
+}
+
+// Creates the index stream in vindexbuf from values, at the current index width
+void StaticGeometryBatch::uploadIndices(const Array<int> &values) {
+	if (shortIndices) {
+		Array<uint16> shorts;
+		shorts.resize(values.size());
+		for (int i = 0; i < values.size(); i++) {
+			shorts[i] = (uint16)values[i];
+		}
+		vindices = IndexStream(shorts, vindexbuf.buffer());
+	} else {
+		vindices = IndexStream(values, vindexbuf.buffer());
+	}
+}
+
+// Only the first indices.size() indices are drawn, so nothing on the GPU needs to change
+void StaticGeometryBatch::clear() {
+	coords.fastClear();
+	normals.fastClear();
+	indices.fastClear();
+}
+
+bool StaticGeometryBatch::overlaps(const Vector2 &lower, const Vector2 &upper) const {
+	return boundsMin.x <= upper.x && boundsMin.y <= upper.y && boundsMax.x >= lower.x && boundsMax.y >= lower.y;
+}
+
+void StaticGeometryBatch::setArgs(Args &args) const {
+	args.setAttributeArray("g3d_Vertex", vcoords);
+	args.setAttributeArray("g3d_Normal", vnormals);
+	args.setPrimitiveType(PrimitiveType::TRIANGLES);
+	args.setIndexStream(vindices);
+	args.setIndexRange(0, indices.size());
+}
@@ -0,0 +1,54 @@
+#ifndef StaticGeometryBatch_h
+#define StaticGeometryBatch_h
+
+#include <G3D/G3DAll.h>
+#include "GrowableVertexBuffer.h"
+
+// All of the scene's static triangles in one vertex buffer and one index buffer,
+// so that every background shape is drawn with a single call. The shapes share
+// one color, set through the objectColor uniform (see UNIFORM_COLOR in vert.vrt). Appending a mesh
+// only writes its own vertices and indices; the earlier ones are uploaded again
+// only when their own buffer has to grow, which happens O(log n) times.
+class StaticGeometryBatch {
+public:
+	StaticGeometryBatch();
+
+	// Adds a triangle mesh whose indices count from its own first vertex
+	void append(const Array<Vector3> &coords, const Array<Vector3> &normals, const Array<int> &indices);
+
+	// Removes every mesh in constant time, keeping the GPU storage for the next scene
+	void clear();
+
+	// Number of indices in use
+	int size() const { return indices.size(); }
+
+	// True if the bounding rectangle of everything in the batch on the z=0 plane overlaps lower..upper
+	bool overlaps(const Vector2 &lower, const Vector2 &upper) const;
+
+	// Binds the indices in use as a triangle list. Indices are 16 bits while the
+	// vertices fit, and switch to 32 bits the first time the vertex buffer grows past that.
+	void setArgs(Args &args) const;
+
+protected:
+	void growVertices();
+	void growIndices();
+	void uploadIndices(const Array<int> &values);
+
+	bool shortIndices;
+
+	// Everything appended since the last clear, kept to fill the new buffers when they grow
+	Array<Vector3> coords;
+	Array<Vector3> normals;
+	Array<int> indices;
+
+	Vector2 boundsMin;
+	Vector2 boundsMax;
+
+	GrowableVertexBuffer vdatabuf;
+	GrowableVertexBuffer vindexbuf;
+	AttributeArray vcoords;
+	AttributeArray vnormals;
+	IndexStream vindices;
+};
+
+#endif
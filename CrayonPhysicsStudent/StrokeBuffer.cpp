@@ -0,0 +1,61 @@
+#include "StrokeBuffer.h"
+
+static const int MIN_CAPACITY = 256;
+
+StrokeBuffer::StrokeBuffer() : uploaded(0), vdatabuf(VertexBuffer::WRITE_EVERY_FRAME, MIN_CAPACITY) {
+}
+
+void StrokeBuffer::clear() {
+	uploaded = 0;
+}
+
+void StrokeBuffer::update(const Array<Vector2> &path) {
+	if (path.size() < uploaded) {
+		uploaded = 0;
+	}
+	if (path.size() == uploaded) {
+		return;
+	}
+
+	if (path.size() > vdatabuf.capacity()) {
+		// Reallocating uploads the whole path, which happens O(log n) times per stroke
+		grow(path);
+		return;
+	}
+
+	for (int i = uploaded; i < path.size(); i++) {
+		vcoords.set(i, path[i]);
+	}
+	uploaded = path.size();
+}
+
+void StrokeBuffer::grow(const Array<Vector2> &path) {
+	vdatabuf.grow(path.size(), sizeof(Vector2) + sizeof(Vector3) + sizeof(Color3));
+	const int capacity = vdatabuf.capacity();
+
+	// Normals and colors are the same for every point, so they are only written here
+	Array<Vector2> coords;
+	Array<Vector3> normals;
+	Array<Color3> colors;
+	coords.resize(capacity);
+	normals.resize(capacity);
+	colors.resize(capacity);
+	for (int i = 0; i < path.size(); i++) {
+		coords[i] = path[i];
+	}
+	normals.setAll(Vector3(0,0,1));
+	colors.setAll(Color3::black());
+
+	vcoords = AttributeArray(coords, vdatabuf.buffer());
+	vnormals = AttributeArray(normals, vdatabuf.buffer());
+	vcolors = AttributeArray(colors, vdatabuf.buffer());
+	uploaded = path.size();
+}
+
+void StrokeBuffer::setArgs(Args &args) const {
+	args.setAttributeArray("g3d_Vertex", vcoords);
+	args.setAttributeArray("g3d_Normal", vnormals);
+	args.setAttributeArray("color", vcolors);
+	args.setPrimitiveType(PrimitiveType::LINE_STRIP);
+	args.setNumIndices(uploaded);
+}
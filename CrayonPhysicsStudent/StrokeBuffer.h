@@ -0,0 +1,40 @@
+#ifndef StrokeBuffer_h
+#define StrokeBuffer_h
+
+#include <G3D/G3DAll.h>
+#include "GrowableVertexBuffer.h"
+
+// GPU copy of the stroke currently being sketched. Capacity grows geometrically,
+// and each update() only writes the points appended since the previous call, so
+// drawing an n-point stroke costs O(1) amortized uploads per frame rather than O(n).
+class StrokeBuffer {
+public:
+	StrokeBuffer();
+
+	// Uploads path[size()..path.size()-1]. If path got shorter it is treated as a new stroke.
+	void update(const Array<Vector2> &path);
+
+	// Forgets the current stroke but keeps the GPU storage for the next one
+	void clear();
+
+	// Number of points on the GPU
+	int size() const { return uploaded; }
+
+	// Binds the stroke as a non-indexed line strip
+	void setArgs(Args &args) const;
+
+protected:
+	void grow(const Array<Vector2> &path);
+
+	int uploaded;
+
+	GrowableVertexBuffer vdatabuf;
+
+	AttributeArray vcoords;
+
+	AttributeArray vnormals;
+
+	AttributeArray vcolors;
+};
+
+#endif
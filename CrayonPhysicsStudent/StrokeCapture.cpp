@@ -0,0 +1,56 @@
+#include "StrokeCapture.h"
+
+StrokeCapture::StrokeCapture(float spacing, int reserve) : spacing(spacing), capturing(false), lastTime(0), traveled(0) {
+	path.reserve(reserve);
+	timestamps.reserve(reserve);
+}
+
+void StrokeCapture::begin(const Vector2 &point, RealTime time) {
+	clear();
+	capturing = true;
+	path.append(point);
+	timestamps.append(time);
+	lastPoint = point;
+	lastTime = time;
+}
+
+void StrokeCapture::moveTo(const Vector2 &point, RealTime time) {
+	if (!capturing) {
+		return;
+	}
+
+	const float length = (point - lastPoint).length();
+	if (length <= 0) {
+		return;
+	}
+
+	// Place a sample every spacing pixels along the segment from lastPoint,
+	// continuing from however far past the last sample the mouse already was
+	float along = spacing - traveled;
+	while (along <= length) {
+		const float t = along / length;
+		path.append(lastPoint.lerp(point, t));
+		timestamps.append(lastTime + (time - lastTime) * t);
+		along += spacing;
+	}
+	traveled = length - (along - spacing);
+
+	lastPoint = point;
+	lastTime = time;
+}
+
+void StrokeCapture::end(const Vector2 &point, RealTime time) {
+	moveTo(point, time);
+	if (capturing && path.last() != point) {
+		path.append(point);
+		timestamps.append(time);
+	}
+	capturing = false;
+}
+
+void StrokeCapture::clear() {
+	path.fastClear();
+	timestamps.fastClear();
+	capturing = false;
+	traveled = 0;
+}
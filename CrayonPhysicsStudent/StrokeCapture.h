@@ -0,0 +1,50 @@
+#ifndef StrokeCapture_h
+#define StrokeCapture_h
+
+#include <G3D/G3DAll.h>
+
+// Records the mouse path of a stroke being sketched, in pixels. Points are kept
+// every `spacing` pixels of distance traveled, however often the mouse is polled:
+// a long jump between two mouse events is filled in with evenly spaced points, and
+// moves shorter than spacing are dropped. Each point has the time it was reached.
+class StrokeCapture {
+public:
+	// reserve is the number of points to allocate room for up front
+	StrokeCapture(float spacing = 2.0f, int reserve = 4096);
+
+	// Starts a new stroke at point, forgetting the previous one
+	void begin(const Vector2 &point, RealTime time);
+
+	// Extends the stroke towards point; does nothing unless a stroke has begun
+	void moveTo(const Vector2 &point, RealTime time);
+
+	// Adds the final point, even if it is closer than spacing, and stops capturing
+	void end(const Vector2 &point, RealTime time);
+
+	// Forgets the stroke but keeps the storage for the next one
+	void clear();
+
+	bool active() const { return capturing; }
+
+	int size() const { return path.size(); }
+
+	const Array<Vector2> &points() const { return path; }
+
+	const Array<RealTime> &times() const { return timestamps; }
+
+protected:
+	float spacing;
+	bool capturing;
+
+	Array<Vector2> path;
+	Array<RealTime> timestamps;
+
+	// Where and when the mouse was last seen, which may be between samples
+	Vector2 lastPoint;
+	RealTime lastTime;
+
+	// Distance traveled since the last sample
+	float traveled;
+};
+
+#endif
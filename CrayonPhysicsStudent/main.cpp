@@ -1,6 +1,7 @@
 #include <G3D/G3DAll.h>
 #include <string>
 #include "App.h"
+#include "PolylineBenchmark.h"
 
 #include "config.h"
 
@@ -11,6 +12,12 @@ G3D_START_AT_MAIN();
 
 int main(int argc, const char* argv[]) {
 	(void)argc; (void)argv;
+	for (int i = 1; i < argc; i++) {
+		if (string(argv[i]) == "--polyline-bench") {
+			return runPolylineBenchmark();
+		}
+	}
+
 	GApp::Settings settings(argc, argv);
 
 	settings.window.width       = 960; 